@@ -17,4 +17,5 @@ ENABLE_DEBUG    = 1
 ENABLE_STATIC   = 1
 ENABLE_SHARED   = 1
 ENABLE_LIBUDEV  = 1
+ENABLE_GLES2    = 0
 
@@ -0,0 +1,185 @@
+/* swc: example/bench.c
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* This program measures the per-frame overhead of the compositor with many
+ * screens. It runs headless, by default with 64 small screens, and a client
+ * in a child process keeps a window on each screen redrawing at the refresh
+ * rate. Every second it prints how long updates took.
+ *
+ * Usage: bench [SECONDS]
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <swc.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <wayland-server.h>
+
+/* Runs the client on the connection fd until the compositor goes away. */
+int bench_client(int fd);
+
+static const uint32_t border_width = 1;
+static const uint32_t border_color = 0xff888888;
+
+static struct wl_display *display;
+static struct wl_event_source *timer;
+static struct wl_array screens;
+static unsigned num_windows;
+static unsigned seconds, elapsed;
+static struct swc_update_stats last;
+
+static void
+new_screen(struct swc_screen *screen)
+{
+	struct swc_screen **entry;
+
+	if ((entry = wl_array_add(&screens, sizeof(*entry))))
+		*entry = screen;
+}
+
+/* Windows are placed on the screens in turn, inset by their border so that
+ * they are composited rather than scanned out. */
+static void
+new_window(struct swc_window *window)
+{
+	struct swc_screen **screen;
+	struct swc_rectangle geometry;
+	unsigned num_screens = screens.size / sizeof(*screen);
+
+	if (num_screens == 0)
+		return;
+
+	screen = (struct swc_screen **)screens.data + num_windows++ % num_screens;
+	geometry = (*screen)->geometry;
+	geometry.x += border_width;
+	geometry.y += border_width;
+	geometry.width -= 2 * border_width;
+	geometry.height -= 2 * border_width;
+
+	swc_window_set_tiled(window);
+	swc_window_set_border(window, border_color, border_width);
+	swc_window_set_geometry(window, &geometry);
+	swc_window_show(window);
+}
+
+const struct swc_manager manager = { &new_screen, &new_window };
+
+static void
+print_stats(const char *label, const struct swc_update_stats *stats, unsigned period)
+{
+	printf("%s: %u screens, %.1f updates/s, %.1f us per update, %.1f us per screen\n",
+	       label, (unsigned)(screens.size / sizeof(struct swc_screen *)),
+	       (double)stats->updates / period,
+	       stats->updates ? stats->update_time / 1e3 / stats->updates : 0,
+	       stats->screens ? stats->screen_time / 1e3 / stats->screens : 0);
+}
+
+static int
+report(void *data)
+{
+	struct swc_update_stats stats, delta;
+	char label[32];
+
+	swc_get_update_stats(&stats);
+	delta.updates = stats.updates - last.updates;
+	delta.update_time = stats.update_time - last.update_time;
+	delta.screens = stats.screens - last.screens;
+	delta.screen_time = stats.screen_time - last.screen_time;
+	last = stats;
+
+	snprintf(label, sizeof(label), "%us", ++elapsed);
+	print_stats(label, &delta, 1);
+
+	if (elapsed < seconds) {
+		wl_event_source_timer_update(timer, 1000);
+	} else {
+		print_stats("total", &stats, seconds);
+		wl_display_terminate(display);
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct wl_event_loop *event_loop;
+	int fds[2], ret = EXIT_FAILURE;
+	pid_t pid;
+
+	seconds = argc > 1 ? strtoul(argv[1], NULL, 10) : 10;
+	if (seconds == 0)
+		seconds = 1;
+	setenv("SWC_HEADLESS", "64*320x240", 0);
+	wl_array_init(&screens);
+
+	/* Fork the client before swc starts any threads. */
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+		goto error0;
+
+	if ((pid = fork()) < 0) {
+		close(fds[1]);
+		goto error1;
+	}
+	if (pid == 0) {
+		close(fds[0]);
+		_exit(bench_client(fds[1]));
+	}
+	close(fds[1]);
+
+	if (!(display = wl_display_create()))
+		goto error2;
+
+	if (!swc_initialize(display, NULL, &manager))
+		goto error3;
+
+	if (!wl_client_create(display, fds[0]))
+		goto error4;
+	fds[0] = -1;
+
+	event_loop = wl_display_get_event_loop(display);
+	if (!(timer = wl_event_loop_add_timer(event_loop, &report, NULL)))
+		goto error4;
+	wl_event_source_timer_update(timer, 1000);
+
+	wl_display_run(display);
+	ret = EXIT_SUCCESS;
+
+	wl_event_source_remove(timer);
+error4:
+	swc_finalize();
+error3:
+	wl_display_destroy(display);
+error2:
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+error1:
+	if (fds[0] != -1)
+		close(fds[0]);
+error0:
+	wl_array_release(&screens);
+	return ret;
+}
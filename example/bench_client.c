@@ -0,0 +1,216 @@
+/* swc: example/bench_client.c
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* The client of the benchmark. It opens a window for each output and redraws
+ * all of it whenever the compositor asks for a new frame. */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+int bench_client(int fd);
+
+struct window {
+	struct wl_surface *surface;
+	struct wl_shell_surface *shell_surface;
+	struct wl_buffer *buffer;
+	uint32_t *data;
+	uint32_t width, height;
+	uint32_t frame;
+	bool drawing;
+};
+
+static struct wl_compositor *compositor;
+static struct wl_shm *shm;
+static struct wl_shell *shell;
+static unsigned num_outputs;
+
+static void draw(struct window *window);
+
+static void
+handle_frame(void *data, struct wl_callback *callback, uint32_t time)
+{
+	wl_callback_destroy(callback);
+	draw(data);
+}
+
+static const struct wl_callback_listener frame_listener = {
+	.done = handle_frame,
+};
+
+static void
+draw(struct window *window)
+{
+	struct wl_callback *callback;
+	uint32_t color = 0xff000000 | (window->frame++ * 0x010203 & 0xffffff);
+	size_t index;
+
+	for (index = 0; index < (size_t)window->width * window->height; ++index)
+		window->data[index] = color;
+
+	wl_surface_attach(window->surface, window->buffer, 0, 0);
+	wl_surface_damage(window->surface, 0, 0, window->width, window->height);
+	callback = wl_surface_frame(window->surface);
+	wl_callback_add_listener(callback, &frame_listener, window);
+	wl_surface_commit(window->surface);
+}
+
+static bool
+create_buffer(struct window *window, uint32_t width, uint32_t height)
+{
+	struct wl_shm_pool *pool;
+	size_t size = (size_t)width * height * 4;
+	void *data;
+	int fd;
+
+	if ((fd = memfd_create("swc-bench", MFD_CLOEXEC)) < 0)
+		goto error0;
+	if (ftruncate(fd, size) < 0)
+		goto error1;
+	if ((data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+		goto error1;
+
+	pool = wl_shm_create_pool(shm, fd, size);
+	close(fd);
+
+	if (window->buffer) {
+		wl_buffer_destroy(window->buffer);
+		munmap(window->data, (size_t)window->width * window->height * 4);
+	}
+
+	window->buffer = wl_shm_pool_create_buffer(pool, 0, width, height, width * 4, WL_SHM_FORMAT_XRGB8888);
+	wl_shm_pool_destroy(pool);
+	window->data = data;
+	window->width = width;
+	window->height = height;
+
+	return true;
+
+error1:
+	close(fd);
+error0:
+	return false;
+}
+
+static void
+ping(void *data, struct wl_shell_surface *shell_surface, uint32_t serial)
+{
+	wl_shell_surface_pong(shell_surface, serial);
+}
+
+static void
+configure(void *data, struct wl_shell_surface *shell_surface, uint32_t edges, int32_t width, int32_t height)
+{
+	struct window *window = data;
+
+	if (width <= 0 || height <= 0 || ((uint32_t)width == window->width && (uint32_t)height == window->height))
+		return;
+
+	if (!create_buffer(window, width, height))
+		return;
+
+	/* From then on, each frame callback draws the next frame. */
+	if (!window->drawing) {
+		window->drawing = true;
+		draw(window);
+	}
+}
+
+static void
+popup_done(void *data, struct wl_shell_surface *shell_surface)
+{
+}
+
+static const struct wl_shell_surface_listener shell_surface_listener = {
+	.ping = ping,
+	.configure = configure,
+	.popup_done = popup_done,
+};
+
+static void
+add_global(void *data, struct wl_registry *registry, uint32_t name, const char *interface, uint32_t version)
+{
+	if (strcmp(interface, "wl_compositor") == 0)
+		compositor = wl_registry_bind(registry, name, &wl_compositor_interface, 1);
+	else if (strcmp(interface, "wl_shm") == 0)
+		shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+	else if (strcmp(interface, "wl_shell") == 0)
+		shell = wl_registry_bind(registry, name, &wl_shell_interface, 1);
+	else if (strcmp(interface, "wl_output") == 0)
+		++num_outputs;
+}
+
+static void
+remove_global(void *data, struct wl_registry *registry, uint32_t name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+	.global = add_global,
+	.global_remove = remove_global,
+};
+
+int
+bench_client(int fd)
+{
+	struct wl_display *display;
+	struct wl_registry *registry;
+	struct window *windows;
+	unsigned index;
+
+	if (!(display = wl_display_connect_to_fd(fd)))
+		goto error0;
+
+	registry = wl_display_get_registry(display);
+	wl_registry_add_listener(registry, &registry_listener, NULL);
+	if (wl_display_roundtrip(display) < 0)
+		goto error1;
+
+	if (!compositor || !shm || !shell || num_outputs == 0)
+		goto error1;
+
+	if (!(windows = calloc(num_outputs, sizeof(*windows))))
+		goto error1;
+
+	for (index = 0; index < num_outputs; ++index) {
+		windows[index].surface = wl_compositor_create_surface(compositor);
+		windows[index].shell_surface = wl_shell_get_shell_surface(shell, windows[index].surface);
+		wl_shell_surface_add_listener(windows[index].shell_surface, &shell_surface_listener, &windows[index]);
+		wl_shell_surface_set_toplevel(windows[index].shell_surface);
+	}
+
+	/* Run until the compositor closes the connection. */
+	while (wl_display_dispatch(display) != -1)
+		;
+
+	wl_display_disconnect(display);
+	return EXIT_SUCCESS;
+
+error1:
+	wl_display_disconnect(display);
+error0:
+	return EXIT_FAILURE;
+}
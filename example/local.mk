@@ -2,15 +2,18 @@
 
 dir := example
 
-$(dir)_PACKAGES = wayland-server xkbcommon
+$(dir)_PACKAGES = wayland-server wayland-client xkbcommon
 $(dir)_CFLAGS = -Ilibswc
 
-$(dir): $(dir)/wm
+$(dir): $(dir)/wm $(dir)/bench
 
 $(dir)/wm: $(dir)/wm.o libswc/libswc.a
 	$(link) $(example_PACKAGE_LIBS) $(libswc_PACKAGE_LIBS) -lm
 
-CLEAN_FILES += $(dir)/wm.o $(dir)/wm
+$(dir)/bench: $(dir)/bench.o $(dir)/bench_client.o libswc/libswc.a
+	$(link) $(example_PACKAGE_LIBS) $(libswc_PACKAGE_LIBS) -lm
+
+CLEAN_FILES += $(dir)/wm.o $(dir)/wm $(dir)/bench.o $(dir)/bench_client.o $(dir)/bench
 
 include common.mk
 
@@ -58,7 +58,7 @@
 static bool nflag;
 static int sigfd[2], sock[2];
 static int input_fds[128], num_input_fds;
-static int drm_fds[16], num_drm_fds;
+static int *drm_fds, num_drm_fds, drm_fds_capacity;
 static int tty_fd;
 static bool active;
 
@@ -209,9 +209,15 @@ handle_socket_data(int socket)
 			}
 			break;
 		case DRM_MAJOR:
-			if (num_drm_fds == ARRAY_LENGTH(drm_fds)) {
-				fprintf(stderr, "too many DRM devices opened\n");
-				goto fail;
+			if (num_drm_fds == drm_fds_capacity) {
+				int capacity = drm_fds_capacity ? drm_fds_capacity * 2 : 4, *fds;
+
+				if (!(fds = realloc(drm_fds, capacity * sizeof(fds[0])))) {
+					fprintf(stderr, "too many DRM devices opened\n");
+					goto fail;
+				}
+				drm_fds = fds;
+				drm_fds_capacity = capacity;
 			}
 			break;
 		default:
@@ -29,14 +29,22 @@
 
 #include "swc.h"
 #include "compositor.h"
+#include "damage.h"
 #include "data_device_manager.h"
 #include "drm.h"
 #include "event.h"
+#ifdef ENABLE_GLES2
+# include "gles2.h"
+#endif
+#include "grid.h"
 #include "internal.h"
 #include "launch.h"
 #include "output.h"
 #include "pointer.h"
+#include "presentation.h"
 #include "region.h"
+#include "render_pool.h"
+#include "render_thread.h"
 #include "screen.h"
 #include "seat.h"
 #include "shm.h"
@@ -48,39 +56,130 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
 #include <wld/wld.h>
 #include <wld/drm.h>
 #include <xkbcommon/xkbcommon-keysyms.h>
+#include "presentation-time-server-protocol.h"
 
 struct target {
 	struct wld_surface *surface;
+	/* After the screen moves or changes size, the surface with the buffer
+	 * still on screen. It is destroyed once the first new frame is displayed. */
+	struct wld_surface *old_surface;
+	/* Whether the screen moved or changed size, so the surface must be
+	 * recreated before the next frame. */
+	bool resized;
+	/* The buffers of the surface for the next and current frames, or NULL if a
+	 * client buffer is scanned out instead. */
 	struct wld_buffer *next_buffer, *current_buffer;
+	/* The buffer of a frame painted while the next frame was still waiting
+	 * for its page flip, or NULL. It is presented once that flip completes. */
+	struct wld_buffer *queued_buffer;
+	/* A buffer in system memory that is composited into instead of the
+	 * surface's buffers, or NULL. The damaged part is then copied to the
+	 * buffer being displayed. Reading scanout buffers may be very slow, so
+	 * this avoids it when blending. */
+	struct wld_buffer *shadow;
+	/* The damage that has not yet been painted into the shadow buffer. */
+	pixman_region32_t shadow_damage;
+	/* The damage in global coordinates accumulated since the screen was last
+	 * repainted. */
+	pixman_region32_t damage;
+	/* A buffer in system memory holding the screen composited without the
+	 * cached view and the views above it, or NULL, and the region of it (in
+	 * target coordinates) that is up to date. */
+	struct wld_buffer *cache;
+	pixman_region32_t cache_valid;
+	/* The client buffers (struct wld_buffer *) displayed directly on hardware
+	 * planes in the next and current frames. They are kept referenced until
+	 * they are no longer on screen. */
+	struct wl_array next_client_buffers, current_client_buffers;
+	/* The views (struct compositor_view *) whose buffers are displayed on the
+	 * primary plane or an overlay plane. */
+	struct wl_array plane_views;
+	/* The presentation feedback for the surfaces in the frame waiting to be
+	 * displayed, separated by whether their buffers are displayed directly,
+	 * and for the surfaces in the queued frame. */
+	struct wl_list feedbacks, zero_copy_feedbacks, queued_feedbacks;
+	/* The job painting the next buffer on the render thread, if rendering. */
+	struct render_job render_job;
+	bool rendering;
 	struct view *view;
 	struct view_handler view_handler;
-	uint32_t mask;
+	struct screen *screen;
 
 	struct wl_listener screen_destroy_listener;
 };
 
 static bool handle_motion(struct pointer_handler *handler, uint32_t time, wl_fixed_t x, wl_fixed_t y);
-static void perform_update(void *data);
+static void schedule_repaint(void);
+static void target_present(struct target *target);
+static uint64_t repaint_time(struct screen *screen, uint64_t now);
+static void handle_render_done(struct render_job *job);
+static void discard_render(struct render_job *job);
 
 static struct pointer_handler pointer_handler = {
 	.motion = handle_motion,
 };
 
+/* The size of the cells in the spatial index of the views. */
+#define GRID_CELL_SIZE 256
+
+/* How long before the vertical blank to start repainting, in nanoseconds. */
+#define DEFAULT_REPAINT_WINDOW 7000000
+
 static struct {
 	struct wl_list views;
-	pixman_region32_t damage, opaque;
+	pixman_region32_t opaque;
+
+	/* Whether a view was removed from the bottom of the stack, so the opaque
+	 * region must be recalculated even though no remaining view is dirty. */
+	bool clip_dirty;
+
+	/* A spatial index of the visible views. */
+	struct grid grid;
+	uint32_t next_order;
 	struct wl_listener swc_listener;
 
-	/* A mask of screens that have been repainted but are waiting on a page flip. */
-	uint32_t pending_flips;
+	/* The screens that have been repainted but are waiting on a page flip, or
+	 * are still being painted on the render thread. */
+	struct screen_set pending_flips;
+
+	/* The screens that are scheduled to be repainted on the next idle. */
+	struct screen_set scheduled_updates;
+
+	/* The screens that are turned off. They are never scheduled to be
+	 * repainted. */
+	struct screen_set off_screens;
 
-	/* A mask of screens that are scheduled to be repainted on the next idle. */
-	uint32_t scheduled_updates;
+	/* The buffers that are displayed on hardware planes or read by render
+	 * operations (struct busy_buffer). Client buffers replaced by a commit are
+	 * not released until they are no longer in use. */
+	struct wl_array busy_buffers;
 
 	bool updating;
+
+	/* Updates are started at the repaint deadline of the screens, which is
+	 * repaint_window nanoseconds before their next vertical blank. This gives
+	 * clients as much time as possible to commit new content for the frame.
+	 * Updates that are already due run from an idle callback instead. */
+	uint64_t repaint_window;
+	int repaint_fd;
+	struct wl_event_source *repaint_source, *idle_source;
+	struct swc_update_stats stats;
+
+	/* Whether composition happens on the render thread. */
+	bool render_thread;
+	/* Whether composition uses the GLES2 renderer instead of wld. */
+	bool gles2;
+	/* Whether screens are composited into shadow buffers. */
+	bool shadow;
+	/* Whether the views below a view being moved or resized are cached, and
+	 * that view, or NULL. */
+	bool render_cache;
+	struct compositor_view *cache_view;
 	struct wl_global *global;
 } compositor;
 
@@ -88,11 +187,163 @@ struct swc_compositor swc_compositor = {
 	.pointer_handler = &pointer_handler,
 };
 
+struct busy_buffer {
+	struct wld_buffer *buffer;
+	uint32_t uses;
+};
+
+static struct busy_buffer *
+find_busy_buffer(struct wld_buffer *buffer)
+{
+	struct busy_buffer *busy;
+
+	wl_array_for_each (busy, &compositor.busy_buffers) {
+		if (busy->buffer == buffer)
+			return busy;
+	}
+
+	return NULL;
+}
+
+/**
+ * References a buffer and counts it as in use.
+ */
+static bool
+use_buffer(struct wld_buffer *buffer)
+{
+	struct busy_buffer *busy;
+
+	if (!(busy = find_busy_buffer(buffer))) {
+		if (!(busy = wl_array_add(&compositor.busy_buffers, sizeof(*busy))))
+			return false;
+		busy->buffer = buffer;
+		busy->uses = 0;
+	}
+
+	++busy->uses;
+	wld_buffer_reference(buffer);
+
+	return true;
+}
+
+/**
+ * Drops a use of a buffer. After the last one, a client buffer that was
+ * replaced in the meantime is released to its client.
+ */
+static void
+unuse_buffer(struct wld_buffer *buffer)
+{
+	struct busy_buffer *busy;
+
+	if ((busy = find_busy_buffer(buffer)) && --busy->uses == 0) {
+		array_remove(&compositor.busy_buffers, busy, sizeof(*busy));
+		surface_release_held_buffer(buffer);
+	}
+
+	wld_buffer_unreference(buffer);
+}
+
+bool
+compositor_buffer_in_use(struct wld_buffer *buffer)
+{
+	return find_busy_buffer(buffer) != NULL;
+}
+
+static void
+release_client_buffers(struct wl_array *buffers)
+{
+	struct wld_buffer **buffer;
+
+	wl_array_for_each (buffer, buffers)
+		unuse_buffer(*buffer);
+	wl_array_release(buffers);
+	wl_array_init(buffers);
+}
+
+static bool
+target_hold_buffer(struct target *target, struct wld_buffer *buffer)
+{
+	struct wld_buffer **held;
+
+	if (!(held = wl_array_add(&target->next_client_buffers, sizeof(*held))))
+		return false;
+
+	if (!use_buffer(buffer)) {
+		target->next_client_buffers.size -= sizeof(*held);
+		return false;
+	}
+	*held = buffer;
+
+	return true;
+}
+
+static bool
+target_add_plane_view(struct target *target, struct compositor_view *view)
+{
+	struct compositor_view **entry;
+
+	if (!(entry = wl_array_add(&target->plane_views, sizeof(*entry))))
+		return false;
+
+	*entry = view;
+
+	return true;
+}
+
+static void
+target_remove_plane_view(struct target *target, struct compositor_view *view)
+{
+	struct compositor_view **entry;
+
+	wl_array_for_each (entry, &target->plane_views) {
+		if (*entry == view) {
+			screen_set_remove(&view->overlays, target->screen->id);
+			array_remove(&target->plane_views, entry, sizeof(*entry));
+			break;
+		}
+	}
+}
+
+static void
+target_clear_plane_views(struct target *target)
+{
+	struct compositor_view **view;
+
+	wl_array_for_each (view, &target->plane_views)
+		screen_set_remove(&(*view)->overlays, target->screen->id);
+
+	target->plane_views.size = 0;
+}
+
 static void
 handle_screen_destroy(struct wl_listener *listener, void *data)
 {
 	struct target *target = wl_container_of(listener, target, screen_destroy_listener);
 
+	/* Wait for the render thread to finish with the buffer, but don't display
+	 * it. */
+	if (target->rendering) {
+		target->render_job.done = &discard_render;
+		render_thread_flush();
+	}
+
+	target_clear_plane_views(target);
+	wl_array_release(&target->plane_views);
+	presentation_discard(&target->feedbacks);
+	presentation_discard(&target->zero_copy_feedbacks);
+	presentation_discard(&target->queued_feedbacks);
+	release_client_buffers(&target->next_client_buffers);
+	release_client_buffers(&target->current_client_buffers);
+	pixman_region32_fini(&target->render_job.copy_region);
+	pixman_region32_fini(&target->shadow_damage);
+	pixman_region32_fini(&target->damage);
+	pixman_region32_fini(&target->cache_valid);
+	if (target->cache)
+		wld_buffer_unreference(target->cache);
+	if (target->shadow)
+		wld_buffer_unreference(target->shadow);
+	if (target->old_surface)
+		wld_destroy_surface(target->old_surface);
 	wld_destroy_surface(target->surface);
 	free(target);
 }
@@ -106,43 +357,363 @@ target_get(struct screen *screen)
 	return listener ? wl_container_of(listener, target, screen_destroy_listener) : NULL;
 }
 
+static int
+compare_order(const void *a, const void *b)
+{
+	const struct compositor_view *view1 = *(struct compositor_view *const *)a,
+	                             *view2 = *(struct compositor_view *const *)b;
+
+	return view1->order < view2->order ? -1 : view1->order > view2->order;
+}
+
+/**
+ * Fills views with the visible views that may overlap the specified box,
+ * ordered from bottom to top.
+ */
+static void
+query_views(const pixman_box32_t *box, struct wl_array *views)
+{
+	struct compositor_view **view;
+
+	grid_query(&compositor.grid, box, views);
+
+	/* Replace the grid entries with their corresponding views. */
+	wl_array_for_each (view, views)
+		*view = wl_container_of(*(struct grid_entry **)view, *view, grid_entry);
+
+	qsort(views->data, views->size / sizeof(*view), sizeof(*view), &compare_order);
+}
+
+static bool
+target_has_plane_view(struct target *target, struct compositor_view *view)
+{
+	struct compositor_view **entry;
+
+	wl_array_for_each (entry, &target->plane_views) {
+		if (*entry == view)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Takes the presentation feedback of the surfaces visible on the target, whose
+ * content is in the frame about to be displayed. The feedback of surfaces that
+ * are composited is added to feedbacks.
+ */
+static void
+target_take_feedbacks(struct target *target, struct wl_list *feedbacks)
+{
+	const struct swc_rectangle *geom = &target->view->geometry;
+	pixman_box32_t box = { geom->x, geom->y, geom->x + geom->width, geom->y + geom->height };
+	struct compositor_view **view;
+	struct wl_list *surface_feedbacks;
+	struct wl_array views;
+
+	wl_array_init(&views);
+	query_views(&box, &views);
+
+	wl_array_for_each (view, &views) {
+		surface_feedbacks = &(*view)->surface->state.feedbacks;
+		if (!screen_set_contains(&(*view)->base.screens, target->screen->id) || wl_list_empty(surface_feedbacks))
+			continue;
+		wl_list_insert_list(target_has_plane_view(target, *view) ? &target->zero_copy_feedbacks : feedbacks, surface_feedbacks);
+		wl_list_init(surface_feedbacks);
+	}
+
+	wl_array_release(&views);
+}
+
+static void
+target_send_feedbacks(struct target *target)
+{
+	struct primary_plane *plane = &target->screen->planes.primary;
+	uint32_t refresh = plane->mode.refresh && !plane->vrr ? 1000000000000ull / plane->mode.refresh : 0;
+	uint32_t flags = 0;
+
+	if (!plane->async_flip)
+		flags |= WP_PRESENTATION_FEEDBACK_KIND_VSYNC;
+	if (plane->hardware_clock)
+		flags |= WP_PRESENTATION_FEEDBACK_KIND_HW_CLOCK | WP_PRESENTATION_FEEDBACK_KIND_HW_COMPLETION;
+
+	presentation_present(&target->feedbacks, target->screen, plane->last_vblank, refresh, plane->msc, flags);
+	presentation_present(&target->zero_copy_feedbacks, target->screen, plane->last_vblank, refresh, plane->msc,
+	                     flags | WP_PRESENTATION_FEEDBACK_KIND_ZERO_COPY);
+}
+
+static void
+frame_view(struct compositor_view *view, uint32_t time)
+{
+	view->last_frame = get_monotonic_time();
+	view->frame_scheduled = false;
+	view_frame(&view->base, time);
+}
+
+static int
+handle_frame_timer(void *data)
+{
+	struct compositor_view *view = data;
+
+	frame_view(view, view->frame_time);
+	return 0;
+}
+
+/**
+ * Sends the frame event to a view at the specified time on the monotonic
+ * clock, or immediately if it has passed.
+ */
+static void
+schedule_frame(struct compositor_view *view, uint32_t time, uint64_t when)
+{
+	uint64_t now = get_monotonic_time(), delay = when > now ? (when - now) / 1000000 : 0;
+
+	if (!view->frame_timer && delay > 0)
+		view->frame_timer = wl_event_loop_add_timer(swc.event_loop, &handle_frame_timer, view);
+
+	if (delay == 0 || !view->frame_timer) {
+		if (view->frame_scheduled)
+			wl_event_source_timer_update(view->frame_timer, 0);
+		frame_view(view, time);
+		return;
+	}
+
+	view->frame_time = time;
+	view->frame_scheduled = true;
+	wl_event_source_timer_update(view->frame_timer, delay);
+}
+
+/* How long before the estimated commit time to send frame events. */
+#define FRAME_MARGIN 1000000
+
+/* The minimum time between frame events for views that are completely
+ * occluded, and for views that are hidden. */
+#define OCCLUDED_FRAME_INTERVAL 200000000
+#define HIDDEN_FRAME_INTERVAL 1000000000
+
+/**
+ * Sends the frame event to a view at the point in the refresh period where
+ * the client should commit its next buffer just before the repaint deadline,
+ * based on how long it took to commit after previous frame events. Occluded
+ * views and views with a frame rate limit may have to wait longer.
+ */
+static void
+send_frame(struct compositor_view *view, uint32_t time, uint64_t deadline)
+{
+	uint64_t now = get_monotonic_time(), latency = view->surface->commit_latency, when = now, interval;
+
+	if (latency != 0 && deadline > now + latency + FRAME_MARGIN)
+		when = deadline - latency - FRAME_MARGIN;
+
+	interval = MAX(view->frame_interval, view->occluded ? OCCLUDED_FRAME_INTERVAL : 0);
+	if (interval != 0)
+		when = MAX(when, view->last_frame + interval);
+
+	schedule_frame(view, time, when);
+}
+
 static void
 handle_screen_frame(struct view_handler *handler, uint32_t time)
 {
 	struct target *target = wl_container_of(handler, target, view_handler);
-	struct compositor_view *view;
+	const struct swc_rectangle *geom = &target->view->geometry;
+	pixman_box32_t box = { geom->x, geom->y, geom->x + geom->width, geom->y + geom->height };
+	struct compositor_view **view;
+	struct wl_array views;
+	uint64_t deadline;
+
+	/* The frame was already finished when the screen was turned off. */
+	if (!screen_set_contains(&compositor.pending_flips, target->screen->id))
+		return;
 
-	compositor.pending_flips &= ~target->mask;
+	screen_set_remove(&compositor.pending_flips, target->screen->id);
+	target_send_feedbacks(target);
 
-	wl_list_for_each (view, &compositor.views, link) {
-		if (view->visible && view->base.screens & target->mask)
-			view_frame(&view->base, time);
+	wl_array_init(&views);
+	query_views(&box, &views);
+
+	deadline = repaint_time(target->screen, get_monotonic_time());
+
+	wl_array_for_each (view, &views) {
+		if (screen_set_contains(&(*view)->base.screens, target->screen->id))
+			send_frame(*view, time, deadline);
 	}
 
-	if (target->current_buffer)
+	wl_array_release(&views);
+
+	if (target->old_surface) {
+		wld_destroy_surface(target->old_surface);
+		target->old_surface = NULL;
+	} else if (target->current_buffer) {
 		wld_surface_release(target->surface, target->current_buffer);
+	}
 
 	target->current_buffer = target->next_buffer;
+	release_client_buffers(&target->current_client_buffers);
+	target->current_client_buffers = target->next_client_buffers;
+	wl_array_init(&target->next_client_buffers);
+
+	/* The queued frame is next. If the render thread is still painting it,
+	 * it is presented when the render thread is done. */
+	if (target->queued_buffer) {
+		target->next_buffer = target->queued_buffer;
+		target->queued_buffer = NULL;
+		wl_list_insert_list(&target->feedbacks, &target->queued_feedbacks);
+		wl_list_init(&target->queued_feedbacks);
+		if (target->rendering)
+			screen_set_add(&compositor.pending_flips, target->screen->id);
+		else
+			target_present(target);
+	}
 
 	/* If we had scheduled updates that couldn't run because we were waiting on a
-	 * page flip, run them now. If the compositor is currently updating, then the
-	 * frame finished immediately, and we can be sure that there are no pending
-	 * updates. */
-	if (compositor.scheduled_updates && !compositor.updating)
-		perform_update(NULL);
+	 * page flip, schedule them for the next frame. */
+	schedule_repaint();
+}
+
+/**
+ * Rebuilds the spatial index of the views to cover the area of the screens.
+ */
+static bool
+rebuild_grid(void)
+{
+	struct compositor_view *view;
+	pixman_region32_t screens_region;
+	struct grid grid;
+	bool ret;
+
+	pixman_region32_init(&screens_region);
+	screens_get_region(&screens_region);
+	ret = grid_initialize(&grid, pixman_region32_extents(&screens_region), GRID_CELL_SIZE);
+	pixman_region32_fini(&screens_region);
+
+	if (!ret)
+		return false;
+
+	grid_finalize(&compositor.grid);
+	compositor.grid = grid;
+
+	wl_list_for_each (view, &compositor.views, link) {
+		grid_entry_initialize(&view->grid_entry);
+		if (view->visible)
+			grid_update(&compositor.grid, &view->grid_entry, &view->extents);
+	}
+
+	return true;
+}
+
+/**
+ * Starts over with a new surface after the screen has moved or changed size.
+ */
+static void
+handle_screen_geometry(struct target *target)
+{
+	struct compositor_view *view;
+
+	/* Frames painted for the old geometry are no longer valid. If the render
+	 * thread was painting the next frame rather than a queued one, no page
+	 * flip is coming for it. */
+	if (target->rendering) {
+		target->render_job.done = &discard_render;
+		render_thread_flush();
+		target->render_job.done = &handle_render_done;
+
+		if (!target->queued_buffer) {
+			screen_set_remove(&compositor.pending_flips, target->screen->id);
+			presentation_discard(&target->feedbacks);
+		}
+	}
+
+	if (target->queued_buffer) {
+		wld_surface_release(target->surface, target->queued_buffer);
+		target->queued_buffer = NULL;
+		presentation_discard(&target->queued_feedbacks);
+	}
+
+	target->resized = true;
+
+	if (!rebuild_grid())
+		WARNING("Could not resize view index\n");
+
+	wl_list_for_each (view, &compositor.views, link) {
+		if (view->visible)
+			view_update_screens(&view->base);
+	}
+
+	if (!screen_set_contains(&compositor.off_screens, target->screen->id)) {
+		screen_set_add(&compositor.scheduled_updates, target->screen->id);
+		schedule_repaint();
+	}
+}
+
+static void
+handle_screen_move(struct view_handler *handler)
+{
+	struct target *target = wl_container_of(handler, target, view_handler);
+
+	handle_screen_geometry(target);
+}
+
+static void
+handle_screen_resize(struct view_handler *handler, uint32_t old_width, uint32_t old_height)
+{
+	struct target *target = wl_container_of(handler, target, view_handler);
+
+	handle_screen_geometry(target);
 }
 
 static const struct view_handler_impl screen_view_handler = {
 	.frame = handle_screen_frame,
+	.move = handle_screen_move,
+	.resize = handle_screen_resize,
 };
 
 static int
 target_swap_buffers(struct target *target)
 {
-	target->next_buffer = wld_surface_take(target->surface);
 	return view_attach(target->view, target->next_buffer);
 }
 
+static void
+target_present(struct target *target)
+{
+	switch (target_swap_buffers(target)) {
+	case -EACCES:
+		/* If we get an EACCES, it is because this session is being deactivated, but
+		 * we haven't yet received the deactivate signal from swc-launch. */
+		swc_deactivate();
+		break;
+	case 0:
+		screen_set_add(&compositor.pending_flips, target->screen->id);
+		return;
+	}
+
+	presentation_discard(&target->feedbacks);
+	presentation_discard(&target->zero_copy_feedbacks);
+}
+
+/**
+ * Attempts to display the buffer of a view directly on the target's screen,
+ * bypassing composition.
+ */
+static int
+target_scanout(struct target *target, struct compositor_view *view)
+{
+	struct wld_buffer *buffer = view->base.buffer;
+	int ret;
+
+	if (!target_hold_buffer(target, buffer))
+		return -ENOMEM;
+
+	if ((ret = view_attach(target->view, buffer)) < 0)
+		return ret;
+
+	target_add_plane_view(target, view);
+	target->next_buffer = NULL;
+
+	return 0;
+}
+
 static struct target *
 target_new(struct screen *screen)
 {
@@ -157,11 +728,36 @@ target_new(struct screen *screen)
 	if (!target->surface)
 		goto error1;
 
+	target->old_surface = NULL;
+	target->resized = false;
 	target->view = &screen->planes.primary.view;
 	target->view_handler.impl = &screen_view_handler;
 	wl_list_insert(&target->view->handlers, &target->view_handler.link);
 	target->current_buffer = NULL;
-	target->mask = screen_mask(screen);
+	target->next_buffer = NULL;
+	target->queued_buffer = NULL;
+	wl_array_init(&target->next_client_buffers);
+	wl_array_init(&target->current_client_buffers);
+	wl_array_init(&target->plane_views);
+	wl_list_init(&target->feedbacks);
+	wl_list_init(&target->zero_copy_feedbacks);
+	wl_list_init(&target->queued_feedbacks);
+	target->render_job.done = &handle_render_done;
+	pixman_region32_init(&target->render_job.copy_region);
+	target->rendering = false;
+
+	/* The shadow buffer starts out with undefined contents. */
+	target->shadow = NULL;
+	pixman_region32_init_rect(&target->shadow_damage, 0, 0, geom->width, geom->height);
+	if (compositor.shadow) {
+		target->shadow = wld_create_buffer(swc.shm->context, geom->width, geom->height, WLD_FORMAT_XRGB8888, 0);
+		if (!target->shadow)
+			WARNING("Could not create shadow buffer, compositing into scanout buffers\n");
+	}
+	pixman_region32_init(&target->damage);
+	target->cache = NULL;
+	pixman_region32_init(&target->cache_valid);
+	target->screen = screen;
 
 	target->screen_destroy_listener.notify = &handle_screen_destroy;
 	wl_signal_add(&screen->destroy_signal, &target->screen_destroy_listener);
@@ -176,13 +772,59 @@ error0:
 
 /* Rendering {{{ */
 
+/**
+ * Copies a region of a buffer positioned at (x, y) into the target, or if ops
+ * is not NULL, adds a render operation doing so. The region is in target
+ * coordinates.
+ */
+static void
+paint_buffer(struct wl_array *ops, struct wld_buffer *buffer, int32_t x, int32_t y, pixman_region32_t *region)
+{
+	struct render_op *op;
+
+	if (!ops) {
+		pixman_region32_translate(region, -x, -y);
+		wld_copy_region(swc.drm->renderer, buffer, x, y, region);
+		pixman_region32_translate(region, x, y);
+	} else if ((op = wl_array_add(ops, sizeof(*op)))) {
+		if (!use_buffer(buffer)) {
+			ops->size -= sizeof(*op);
+			return;
+		}
+		pixman_region32_init(&op->region);
+		pixman_region32_copy(&op->region, region);
+		op->buffer = buffer;
+		op->x = x;
+		op->y = y;
+	}
+}
+
+static void
+paint_fill(struct wl_array *ops, uint32_t color, pixman_region32_t *region)
+{
+	struct render_op *op;
+
+	if (!ops) {
+		wld_fill_region(swc.drm->renderer, color, region);
+	} else if ((op = wl_array_add(ops, sizeof(*op)))) {
+		pixman_region32_init(&op->region);
+		pixman_region32_copy(&op->region, region);
+		op->buffer = NULL;
+		op->color = color;
+	}
+}
+
+/**
+ * Paints the damaged part of a view. When painting the render cache, the view
+ * is not clipped by the views above it, since those may move.
+ */
 static void
-repaint_view(struct target *target, struct compositor_view *view, pixman_region32_t *damage)
+repaint_view(struct target *target, struct compositor_view *view, pixman_region32_t *damage, bool cache, struct wl_array *ops)
 {
 	pixman_region32_t view_region, view_damage, border_damage;
 	const struct swc_rectangle *geom = &view->base.geometry, *target_geom = &target->view->geometry;
 
-	if (!view->base.buffer)
+	if (!view->base.buffer || (view->occluded && !cache))
 		return;
 
 	pixman_region32_init_rect(&view_region, geom->x, geom->y, geom->width, geom->height);
@@ -190,15 +832,17 @@ repaint_view(struct target *target, struct compositor_view *view, pixman_region3
 	pixman_region32_init(&border_damage);
 
 	pixman_region32_intersect(&view_damage, &view_damage, damage);
-	pixman_region32_subtract(&view_damage, &view_damage, &view->clip);
+	if (!cache)
+		pixman_region32_subtract(&view_damage, &view_damage, &view->clip);
 	pixman_region32_subtract(&border_damage, &view_damage, &view_region);
 	pixman_region32_intersect(&view_damage, &view_damage, &view_region);
 
 	pixman_region32_fini(&view_region);
 
-	if (pixman_region32_not_empty(&view_damage)) {
-		pixman_region32_translate(&view_damage, -geom->x, -geom->y);
-		wld_copy_region(swc.drm->renderer, view->buffer, geom->x - target_geom->x, geom->y - target_geom->y, &view_damage);
+	/* Views on overlay planes only need their border drawn. */
+	if (pixman_region32_not_empty(&view_damage) && (cache || !screen_set_contains(&view->overlays, target->screen->id))) {
+		pixman_region32_translate(&view_damage, -target_geom->x, -target_geom->y);
+		paint_buffer(ops, view->buffer, geom->x - target_geom->x, geom->y - target_geom->y, &view_damage);
 	}
 
 	pixman_region32_fini(&view_damage);
@@ -206,35 +850,236 @@ repaint_view(struct target *target, struct compositor_view *view, pixman_region3
 	/* Draw border */
 	if (pixman_region32_not_empty(&border_damage)) {
 		pixman_region32_translate(&border_damage, -target_geom->x, -target_geom->y);
-		wld_fill_region(swc.drm->renderer, view->border.color, &border_damage);
+		paint_fill(ops, view->border.color, &border_damage);
 	}
 
 	pixman_region32_fini(&border_damage);
 }
 
+/**
+ * Paints the damaged part of the target, or if ops is not NULL, adds the
+ * render operations needed to do so.
+ */
 static void
-renderer_repaint(struct target *target, pixman_region32_t *damage, pixman_region32_t *base_damage, struct wl_list *views)
+paint_target(struct target *target, pixman_region32_t *damage, pixman_region32_t *base_damage, struct wl_array *views, struct wl_array *ops)
 {
-	struct compositor_view *view;
+	struct compositor_view **view;
+	pixman_region32_t cache_damage;
+	uint32_t order = 0;
+
+	if (target->cache) {
+		/* Everything below the cached view comes from the render cache. */
+		pixman_region32_init(&cache_damage);
+		pixman_region32_copy(&cache_damage, damage);
+		pixman_region32_translate(&cache_damage, -target->view->geometry.x, -target->view->geometry.y);
+		paint_buffer(ops, target->cache, 0, 0, &cache_damage);
+		pixman_region32_fini(&cache_damage);
+		order = compositor.cache_view->order;
+	} else if (pixman_region32_not_empty(base_damage)) {
+		/* Paint base damage black. */
+		pixman_region32_translate(base_damage, -target->view->geometry.x, -target->view->geometry.y);
+		paint_fill(ops, 0xff000000, base_damage);
+	}
+
+	wl_array_for_each (view, views) {
+		if ((*view)->order >= order && screen_set_contains(&(*view)->base.screens, target->screen->id))
+			repaint_view(target, *view, damage, false, ops);
+	}
+}
+
+/**
+ * Paints the parts of the damage (in global coordinates) that are missing
+ * from the render cache of the target. Views are ordered from bottom to top.
+ */
+static bool
+target_update_cache(struct target *target, pixman_region32_t *damage, struct wl_array *views)
+{
+	const struct swc_rectangle *geom = &target->view->geometry;
+	struct compositor_view **view;
+	pixman_region32_t missing;
+
+	if (!target->cache) {
+		target->cache = wld_create_buffer(swc.shm->context, geom->width, geom->height, WLD_FORMAT_XRGB8888, 0);
+		if (!target->cache)
+			return false;
+		pixman_region32_clear(&target->cache_valid);
+	}
+
+	pixman_region32_init(&missing);
+	pixman_region32_copy(&missing, damage);
+	pixman_region32_translate(&missing, -geom->x, -geom->y);
+	pixman_region32_subtract(&missing, &missing, &target->cache_valid);
+
+	if (pixman_region32_not_empty(&missing)) {
+		pixman_region32_union(&target->cache_valid, &target->cache_valid, &missing);
+		wld_set_target_buffer(swc.drm->renderer, target->cache);
+		paint_fill(NULL, 0xff000000, &missing);
+		pixman_region32_translate(&missing, geom->x, geom->y);
+		wl_array_for_each (view, views) {
+			if ((*view)->order >= compositor.cache_view->order)
+				break;
+			if (screen_set_contains(&(*view)->base.screens, target->screen->id))
+				repaint_view(target, *view, &missing, true, NULL);
+		}
+		wld_flush(swc.drm->renderer);
+	}
+
+	pixman_region32_fini(&missing);
+
+	return true;
+}
+
+static void
+target_release_cache(struct target *target)
+{
+	if (target->cache) {
+		wld_buffer_unreference(target->cache);
+		target->cache = NULL;
+	}
+	pixman_region32_clear(&target->cache_valid);
+}
+
+/**
+ * Returns the buffer of the frame being painted, which is the queued frame if
+ * there is one.
+ */
+static struct wld_buffer *
+target_back_buffer(struct target *target)
+{
+	return target->queued_buffer ? target->queued_buffer : target->next_buffer;
+}
+
+/**
+ * Returns the buffer that the target is composited into.
+ */
+static struct wld_buffer *
+target_paint_buffer(struct target *target)
+{
+	return target->shadow ? target->shadow : target_back_buffer(target);
+}
+
+/**
+ * Copies the specified region of the shadow buffer to the back buffer.
+ */
+static void
+copy_shadow(struct target *target, pixman_region32_t *region)
+{
+	wld_set_target_buffer(swc.drm->renderer, target_back_buffer(target));
+	wld_copy_region(swc.drm->renderer, target->shadow, 0, 0, region);
+}
+
+static void
+paint_ops(struct target *target, struct wl_array *ops, pixman_region32_t *copy_damage)
+{
+	struct render_op *op;
+
+	wld_set_target_buffer(swc.drm->renderer, target_paint_buffer(target));
+	wl_array_for_each (op, ops) {
+		if (op->buffer)
+			paint_buffer(NULL, op->buffer, op->x, op->y, &op->region);
+		else
+			paint_fill(NULL, op->color, &op->region);
+	}
+	if (target->shadow)
+		copy_shadow(target, copy_damage);
+	wld_flush(swc.drm->renderer);
+}
+
+static void
+release_ops(struct wl_array *ops)
+{
+	struct render_op *op;
+
+	wl_array_for_each (op, ops) {
+		pixman_region32_fini(&op->region);
+		if (op->buffer)
+			unuse_buffer(op->buffer);
+	}
+	wl_array_release(ops);
+}
+
+/**
+ * Paints the target. If the target has a shadow buffer, the damage is painted
+ * into it, and copy_damage (in target coordinates) is then copied to the next
+ * buffer.
+ */
+static void
+renderer_repaint(struct target *target, pixman_region32_t *damage, pixman_region32_t *base_damage, struct wl_array *views, pixman_region32_t *copy_damage)
+{
+	struct wl_array ops;
 
 	DEBUG("Rendering to target { x: %d, y: %d, w: %u, h: %u }\n",
 	      target->view->geometry.x, target->view->geometry.y,
 	      target->view->geometry.width, target->view->geometry.height);
 
-	wld_set_target_surface(swc.drm->renderer, target->surface);
-
-	/* Paint base damage black. */
-	if (pixman_region32_not_empty(base_damage)) {
-		pixman_region32_translate(base_damage, -target->view->geometry.x, -target->view->geometry.y);
-		wld_fill_region(swc.drm->renderer, 0xff000000, base_damage);
+#ifdef ENABLE_GLES2
+	if (compositor.gles2) {
+		wl_array_init(&ops);
+		paint_target(target, damage, base_damage, views, &ops);
+		if (!gles2_paint(target_paint_buffer(target), &ops))
+			paint_ops(target, &ops, copy_damage);
+		release_ops(&ops);
+		return;
+	}
+#endif
+
+	if (!render_pool_should_use(damage)) {
+		wld_set_target_buffer(swc.drm->renderer, target_paint_buffer(target));
+		paint_target(target, damage, base_damage, views, NULL);
+		if (target->shadow)
+			copy_shadow(target, copy_damage);
+		wld_flush(swc.drm->renderer);
+		return;
 	}
 
-	wl_list_for_each_reverse (view, views, link) {
-		if (view->visible && view->base.screens & target->mask)
-			repaint_view(target, view, damage);
+	/* For large damage, collect the operations so that they can be split
+	 * between the threads of the render pool. */
+	wl_array_init(&ops);
+	paint_target(target, damage, base_damage, views, &ops);
+	if (render_pool_map(target_paint_buffer(target), &ops)) {
+		render_pool_paint(target_paint_buffer(target), &ops);
+		render_pool_unmap(target_paint_buffer(target), &ops);
+		if (target->shadow)
+			copy_shadow(target, copy_damage);
+	} else {
+		paint_ops(target, &ops, copy_damage);
 	}
+	release_ops(&ops);
+}
 
-	wld_flush(swc.drm->renderer);
+/**
+ * Starts painting the target on the render thread. The buffers of the views
+ * are used by the render operations until the job finishes, so they are not
+ * released to their clients, who could draw into them in the meantime, even
+ * if the views are changed or destroyed.
+ */
+static void
+renderer_submit(struct target *target, pixman_region32_t *damage, pixman_region32_t *base_damage, struct wl_array *views, pixman_region32_t *copy_damage)
+{
+	struct render_job *job = &target->render_job;
+
+	DEBUG("Submitting target { x: %d, y: %d, w: %u, h: %u } to render thread\n",
+	      target->view->geometry.x, target->view->geometry.y,
+	      target->view->geometry.width, target->view->geometry.height);
+
+	job->buffer = target_paint_buffer(target);
+	job->copy_buffer = target->shadow ? target_back_buffer(target) : NULL;
+	if (target->shadow)
+		pixman_region32_copy(&job->copy_region, copy_damage);
+	wl_array_init(&job->ops);
+	paint_target(target, damage, base_damage, views, &job->ops);
+	target->rendering = true;
+	render_thread_submit(job);
+}
+
+static bool
+renderer_can_read(struct wld_buffer *buffer)
+{
+#ifdef ENABLE_GLES2
+	if (compositor.gles2)
+		return gles2_can_read(buffer);
+#endif
+	return wld_capabilities(swc.drm->renderer, buffer) & WLD_CAPABILITY_READ;
 }
 
 static int
@@ -242,7 +1087,7 @@ renderer_attach(struct compositor_view *view, struct wld_buffer *client_buffer)
 {
 	struct wld_buffer *buffer;
 	bool was_proxy = view->buffer != view->base.buffer;
-	bool needs_proxy = client_buffer && !(wld_capabilities(swc.drm->renderer, client_buffer) & WLD_CAPABILITY_READ);
+	bool needs_proxy = client_buffer && !renderer_can_read(client_buffer);
 	bool resized = view->buffer && client_buffer && (view->buffer->width != client_buffer->width || view->buffer->height != client_buffer->height);
 
 	if (client_buffer) {
@@ -266,6 +1111,13 @@ renderer_attach(struct compositor_view *view, struct wld_buffer *client_buffer)
 		buffer = NULL;
 	}
 
+#ifdef ENABLE_GLES2
+	/* The texture already holds the contents of the surface, so only the
+	 * damage of the new buffer needs to be uploaded. */
+	if (compositor.gles2)
+		gles2_move_texture(view->buffer, buffer);
+#endif
+
 	/* If we no longer need a proxy buffer, or the original buffer is of a
 	 * different size, destroy the old proxy image. */
 	if (view->buffer && ((!needs_proxy && was_proxy) || (needs_proxy && resized)))
@@ -279,18 +1131,54 @@ renderer_attach(struct compositor_view *view, struct wld_buffer *client_buffer)
 static void
 renderer_flush_view(struct compositor_view *view)
 {
-	if (view->buffer == view->base.buffer)
-		return;
+	if (view->buffer != view->base.buffer) {
+		wld_set_target_buffer(swc.shm->renderer, view->buffer);
+		wld_copy_region(swc.shm->renderer, view->base.buffer, 0, 0, &view->surface->state.damage);
+		wld_flush(swc.shm->renderer);
+	}
 
-	wld_set_target_buffer(swc.shm->renderer, view->buffer);
-	wld_copy_region(swc.shm->renderer, view->base.buffer, 0, 0, &view->surface->state.damage);
-	wld_flush(swc.shm->renderer);
+#ifdef ENABLE_GLES2
+	if (compositor.gles2)
+		gles2_flush_buffer(view->buffer, &view->surface->state.damage);
+#endif
 }
 
 /* }}} */
 
 /* Surface Views {{{ */
 
+/**
+ * Adds a region in global coordinates, where the contents of a view changed,
+ * to the damage of the screens it overlaps. If the view is below the cached
+ * view, the region is no longer valid in the render cache.
+ */
+static void
+add_damage(struct compositor_view *view, pixman_region32_t *region)
+{
+	struct screen *screen;
+	struct target *target;
+	const struct swc_rectangle *geom;
+	pixman_region32_t screen_damage;
+
+	if (!pixman_region32_not_empty(region))
+		return;
+
+	pixman_region32_init(&screen_damage);
+	wl_list_for_each (screen, &swc.screens, link) {
+		if (!(target = target_get(screen)))
+			continue;
+		geom = &screen->base.geometry;
+		pixman_region32_intersect_rect(&screen_damage, region, geom->x, geom->y, geom->width, geom->height);
+		pixman_region32_union(&target->damage, &target->damage, &screen_damage);
+
+		if (compositor.cache_view && view->order < compositor.cache_view->order) {
+			pixman_region32_translate(&screen_damage, -geom->x, -geom->y);
+			pixman_region32_subtract(&target->cache_valid, &target->cache_valid, &screen_damage);
+		}
+	}
+	pixman_region32_fini(&screen_damage);
+}
+
 /**
  * Adds damage from the region below a view, taking into account it's clip
  * region, to the region specified by `damage'.
@@ -302,7 +1190,7 @@ damage_below_view(struct compositor_view *view)
 
 	pixman_region32_init_with_extents(&damage_below, &view->extents);
 	pixman_region32_subtract(&damage_below, &damage_below, &view->clip);
-	pixman_region32_union(&compositor.damage, &compositor.damage, &damage_below);
+	add_damage(view, &damage_below);
 	pixman_region32_fini(&damage_below);
 }
 
@@ -324,25 +1212,120 @@ update_extents(struct compositor_view *view)
 	view->extents.x2 = view->base.geometry.x + view->base.geometry.width + view->border.width;
 	view->extents.y2 = view->base.geometry.y + view->base.geometry.height + view->border.width;
 
+	if (view->visible)
+		grid_update(&compositor.grid, &view->grid_entry, &view->extents);
+
+	view->clip_dirty = true;
+
 	/* Damage border. */
 	view->border.damaged = true;
 }
 
+/**
+ * Schedules updates of the specified screens, or of all screens if screens is
+ * NULL.
+ */
 static void
-schedule_updates(uint32_t screens)
+schedule_updates(const struct screen_set *screens)
 {
-	if (compositor.scheduled_updates == 0)
-		wl_event_loop_add_idle(swc.event_loop, &perform_update, NULL);
-
-	if (screens == -1) {
-		struct screen *screen;
+	struct screen *screen;
 
-		screens = 0;
+	if (!screens) {
 		wl_list_for_each (screen, &swc.screens, link)
-			screens |= screen_mask(screen);
+			screen_set_add(&compositor.scheduled_updates, screen->id);
+	} else if (!screen_set_contains_set(&compositor.scheduled_updates, screens)) {
+		screen_set_union(&compositor.scheduled_updates, screens);
+	} else {
+		return;
 	}
 
-	compositor.scheduled_updates |= screens;
+	screen_set_subtract(&compositor.scheduled_updates, &compositor.off_screens);
+	schedule_repaint();
+}
+
+/**
+ * Sends the frame event at a low rate to a view that doesn't get it from the
+ * screens, if its client is waiting for one, so that it doesn't stall.
+ */
+static void
+schedule_idle_frame(struct compositor_view *view)
+{
+	uint64_t now;
+
+	if (!view->frame_scheduled && !wl_list_empty(&view->surface->state.frame_callbacks)) {
+		now = get_monotonic_time();
+		schedule_frame(view, now / 1000000, view->last_frame + HIDDEN_FRAME_INTERVAL);
+	}
+}
+
+/**
+ * Returns whether all the screens a view is on are turned off.
+ */
+static bool
+only_on_screens_off(struct compositor_view *view)
+{
+	return !screen_set_is_empty(&view->base.screens) && screen_set_contains_set(&compositor.off_screens, &view->base.screens);
+}
+
+bool
+compositor_set_screen_power(struct screen *screen, bool on)
+{
+	const struct swc_rectangle *geom = &screen->base.geometry;
+	struct compositor_view *view;
+	struct target *target;
+
+	if (screen->planes.primary.off == !on)
+		return true;
+
+	if (!primary_plane_set_power(&screen->planes.primary, on))
+		return false;
+
+	if (!on) {
+		screen_set_add(&compositor.off_screens, screen->id);
+		screen_set_remove(&compositor.scheduled_updates, screen->id);
+
+		/* A page flip that is on its way may never complete now, so finish
+		 * the frame right away. A frame that was still being painted or was
+		 * queued behind it is never displayed. */
+		if ((target = target_get(screen))) {
+			if (target->rendering) {
+				target->render_job.done = &discard_render;
+				render_thread_flush();
+				target->render_job.done = &handle_render_done;
+
+				if (!target->queued_buffer)
+					presentation_discard(&target->feedbacks);
+			}
+
+			if (target->queued_buffer) {
+				wld_surface_release(target->surface, target->queued_buffer);
+				target->queued_buffer = NULL;
+				presentation_discard(&target->queued_feedbacks);
+			}
+
+			if (screen_set_contains(&compositor.pending_flips, screen->id))
+				handle_screen_frame(&target->view_handler, get_monotonic_time() / 1000000);
+		}
+
+		/* The views waiting for the next frame only get frame events at a low
+		 * rate from now on. */
+		wl_list_for_each (view, &compositor.views, link) {
+			if (view->visible && screen_set_contains(&view->base.screens, screen->id) && only_on_screens_off(view))
+				schedule_idle_frame(view);
+		}
+
+		return true;
+	}
+
+	/* The contents of the screen weren't kept up to date while it was off,
+	 * so repaint all of it. */
+	screen_set_remove(&compositor.off_screens, screen->id);
+	if ((target = target_get(screen)))
+		pixman_region32_union_rect(&target->damage, &target->damage, geom->x, geom->y, geom->width, geom->height);
+	screen_set_add(&compositor.scheduled_updates, screen->id);
+	schedule_repaint();
+
+	return true;
 }
 
 static bool
@@ -350,10 +1333,25 @@ update(struct view *base)
 {
 	struct compositor_view *view = (void *)base;
 
-	if (!swc.active || !view->visible)
+	if (!swc.active)
 		return false;
 
-	schedule_updates(view->base.screens);
+	/* Hidden views and views on screens that are turned off don't get frame
+	 * events from the screens. */
+	if (!view->visible) {
+		schedule_idle_frame(view);
+		return false;
+	}
+
+	if (only_on_screens_off(view))
+		schedule_idle_frame(view);
+
+	/* The opaque region depends on the size of the buffer as well as the
+	 * opaque region set by the client. */
+	if (view->surface->pending.commit & (SURFACE_COMMIT_ATTACH | SURFACE_COMMIT_OPAQUE))
+		view->clip_dirty = true;
+
+	schedule_updates(&view->base.screens);
 
 	return true;
 }
@@ -434,6 +1432,7 @@ compositor_create_view(struct surface *surface)
 	view->window = NULL;
 	view->parent = NULL;
 	view->visible = false;
+	view->order = ++compositor.next_order;
 	view->extents.x1 = 0;
 	view->extents.y1 = 0;
 	view->extents.x2 = 0;
@@ -442,6 +1441,15 @@ compositor_create_view(struct surface *surface)
 	view->border.color = 0x000000;
 	view->border.damaged = false;
 	pixman_region32_init(&view->clip);
+	pixman_region32_init(&view->opaque);
+	screen_set_initialize(&view->overlays);
+	view->clip_dirty = false;
+	view->occluded = false;
+	view->frame_timer = NULL;
+	view->frame_scheduled = false;
+	view->frame_interval = 0;
+	view->last_frame = 0;
+	grid_entry_initialize(&view->grid_entry);
 	wl_signal_init(&view->destroy_signal);
 	surface_set_view(surface, &view->base);
 	wl_list_insert(&compositor.views, &view->link);
@@ -452,11 +1460,38 @@ compositor_create_view(struct surface *surface)
 void
 compositor_view_destroy(struct compositor_view *view)
 {
+	struct compositor_view *below;
+	struct screen *screen;
+	struct target *target;
+
 	wl_signal_emit(&view->destroy_signal, NULL);
+	compositor_view_end_interaction(view);
 	compositor_view_hide(view);
+
+	wl_list_for_each (screen, &swc.screens, link) {
+		if ((target = target_get(screen)))
+			target_remove_plane_view(target, view);
+	}
+
+	if (view->frame_timer)
+		wl_event_source_remove(view->frame_timer);
 	surface_set_view(view->surface, NULL);
 	view_finalize(&view->base);
+	screen_set_finalize(&view->overlays);
 	pixman_region32_fini(&view->clip);
+	pixman_region32_fini(&view->opaque);
+
+	/* Make sure the clip regions below the view get recalculated, or if there
+	 * are none, at least the opaque region. */
+	if (view->clip_dirty) {
+		if (view->link.next != &compositor.views) {
+			below = wl_container_of(view->link.next, below, link);
+			below->clip_dirty = true;
+		} else {
+			compositor.clip_dirty = true;
+		}
+	}
+
 	wl_list_remove(&view->link);
 	free(view);
 }
@@ -488,10 +1523,12 @@ compositor_view_show(struct compositor_view *view)
 
 	view->visible = true;
 	view_update_screens(&view->base);
+	grid_update(&compositor.grid, &view->grid_entry, &view->extents);
 
 	/* Assume worst-case no clipping until we draw the next frame (in case the
 	 * surface gets moved before that. */
 	pixman_region32_clear(&view->clip);
+	view->clip_dirty = true;
 	damage_view(view);
 	update(&view->base);
 
@@ -505,6 +1542,7 @@ void
 compositor_view_hide(struct compositor_view *view)
 {
 	struct compositor_view *other;
+	struct screen_set none;
 
 	if (!view->visible)
 		return;
@@ -513,8 +1551,11 @@ compositor_view_hide(struct compositor_view *view)
 	update(&view->base);
 	damage_below_view(view);
 
-	view_set_screens(&view->base, 0);
+	screen_set_initialize(&none);
+	view_set_screens(&view->base, &none);
+	grid_remove(&compositor.grid, &view->grid_entry);
 	view->visible = false;
+	view->clip_dirty = true;
 
 	wl_list_for_each (other, &compositor.views, link) {
 		if (other->parent == view)
@@ -538,47 +1579,119 @@ compositor_view_set_border_width(struct compositor_view *view, uint32_t width)
 }
 
 void
-compositor_view_set_border_color(struct compositor_view *view, uint32_t color)
+compositor_view_set_border_color(struct compositor_view *view, uint32_t color)
+{
+	if (view->border.color == color)
+		return;
+
+	view->border.color = color;
+	view->border.damaged = true;
+
+	/* XXX: Damage above surface for transparent surfaces? */
+
+	update(&view->base);
+}
+
+void
+compositor_view_set_frame_rate_limit(struct compositor_view *view, uint32_t rate)
+{
+	view->frame_interval = rate ? 1000000000 / rate : 0;
+}
+
+static void
+release_caches(void)
+{
+	struct screen *screen;
+	struct target *target;
+
+	wl_list_for_each (screen, &swc.screens, link) {
+		if ((target = target_get(screen)))
+			target_release_cache(target);
+	}
+}
+
+void
+compositor_view_begin_interaction(struct compositor_view *view)
+{
+	if (!compositor.render_cache || compositor.cache_view == view)
+		return;
+
+	/* The cache of another view holds different views. */
+	release_caches();
+	compositor.cache_view = view;
+}
+
+void
+compositor_view_end_interaction(struct compositor_view *view)
 {
-	if (view->border.color == color)
+	if (compositor.cache_view != view)
 		return;
 
-	view->border.color = color;
-	view->border.damaged = true;
-
-	/* XXX: Damage above surface for transparent surfaces? */
-
-	update(&view->base);
+	release_caches();
+	compositor.cache_view = NULL;
 }
 
 /* }}} */
 
+/**
+ * Recalculates the clip regions of the views, and collects the damage of the
+ * views on the specified screens into the damage of the screens they cover.
+ * The damage of views only on other screens is left until they are repainted.
+ */
 static void
-calculate_damage(void)
+calculate_damage(const struct screen_set *screens)
 {
-	struct compositor_view *view;
+	struct compositor_view *view, *above = NULL;
 	struct swc_rectangle *geom;
-	pixman_region32_t surface_opaque, *surface_damage;
-
-	pixman_region32_clear(&compositor.opaque);
-	pixman_region32_init(&surface_opaque);
+	pixman_region32_t *surface_damage;
+	bool dirty = false;
 
-	/* Go through views top-down to calculate clipping regions. */
+	/* Go through views top-down to calculate clipping regions. The clip regions
+	 * of views above the first dirty view are still valid, so we only need to
+	 * recalculate them starting from that view. */
 	wl_list_for_each (view, &compositor.views, link) {
+		if (view->clip_dirty && !dirty) {
+			dirty = true;
+
+			/* Start with the opaque region covering the view above. */
+			if (above)
+				pixman_region32_union(&compositor.opaque, &above->clip, &above->opaque);
+			else
+				pixman_region32_clear(&compositor.opaque);
+		}
+
+		view->clip_dirty = false;
+
 		if (!view->visible)
 			continue;
 
 		geom = &view->base.geometry;
 
-		/* Clip the surface by the opaque region covering it. */
-		pixman_region32_copy(&view->clip, &compositor.opaque);
+		if (dirty) {
+			/* Clip the surface by the opaque region covering it. */
+			pixman_region32_copy(&view->clip, &compositor.opaque);
+
+			/* Buffers without an alpha channel are opaque regardless of
+			 * the opaque region set by the client. */
+			if (view->base.buffer && view->base.buffer->format == WLD_FORMAT_XRGB8888) {
+				pixman_region32_fini(&view->opaque);
+				pixman_region32_init_rect(&view->opaque, geom->x, geom->y, geom->width, geom->height);
+			} else {
+				/* Translate the opaque region to global coordinates. */
+				pixman_region32_copy(&view->opaque, &view->surface->state.opaque);
+				pixman_region32_translate(&view->opaque, geom->x, geom->y);
+			}
+
+			view->occluded = pixman_region32_contains_rectangle(&view->clip, &view->extents) == PIXMAN_REGION_IN;
+
+			/* Add the surface's opaque region to the accumulated opaque region. */
+			pixman_region32_union(&compositor.opaque, &compositor.opaque, &view->opaque);
+		}
 
-		/* Translate the opaque region to global coordinates. */
-		pixman_region32_copy(&surface_opaque, &view->surface->state.opaque);
-		pixman_region32_translate(&surface_opaque, geom->x, geom->y);
+		above = view;
 
-		/* Add the surface's opaque region to the accumulated opaque region. */
-		pixman_region32_union(&compositor.opaque, &compositor.opaque, &surface_opaque);
+		if (!screen_set_intersects(&view->base.screens, screens))
+			continue;
 
 		surface_damage = &view->surface->state.damage;
 
@@ -588,8 +1701,7 @@ calculate_damage(void)
 			/* Translate surface damage to global coordinates. */
 			pixman_region32_translate(surface_damage, geom->x, geom->y);
 
-			/* Add the surface damage to the compositor damage. */
-			pixman_region32_union(&compositor.damage, &compositor.damage, surface_damage);
+			add_damage(view, surface_damage);
 			pixman_region32_clear(surface_damage);
 		}
 
@@ -601,7 +1713,7 @@ calculate_damage(void)
 
 			pixman_region32_subtract(&border_region, &border_region, &view_region);
 
-			pixman_region32_union(&compositor.damage, &compositor.damage, &border_region);
+			add_damage(view, &border_region);
 
 			pixman_region32_fini(&border_region);
 			pixman_region32_fini(&view_region);
@@ -610,82 +1722,573 @@ calculate_damage(void)
 		}
 	}
 
-	pixman_region32_fini(&surface_opaque);
+	/* If only views at the bottom were removed, the opaque region is that of
+	 * the remaining views. */
+	if (compositor.clip_dirty && !dirty) {
+		if (above)
+			pixman_region32_union(&compositor.opaque, &above->clip, &above->opaque);
+		else
+			pixman_region32_clear(&compositor.opaque);
+	}
+
+	compositor.clip_dirty = false;
+}
+
+/**
+ * Determines whether the buffer of a view can be displayed on a hardware plane
+ * in place of the view.
+ */
+static bool
+can_display_on_plane(struct compositor_view *view)
+{
+	struct wld_buffer *buffer = view->base.buffer;
+	union wld_object object;
+
+	if (swc.headless || !buffer || view->buffer != buffer)
+		return false;
+
+	if (buffer->format != WLD_FORMAT_XRGB8888 && buffer->format != WLD_FORMAT_ARGB8888)
+		return false;
+
+	if (buffer->width != view->base.geometry.width || buffer->height != view->base.geometry.height)
+		return false;
+
+	return wld_export(buffer, WLD_DRM_OBJECT_HANDLE, &object);
+}
+
+/**
+ * Determines whether the view covers the entire screen with an opaque buffer
+ * that can be displayed directly.
+ */
+static bool
+can_scanout(struct compositor_view *view, const struct swc_rectangle *geom)
+{
+	if (view->border.width != 0 || view->base.geometry.x != geom->x || view->base.geometry.y != geom->y
+	    || view->base.geometry.width != geom->width || view->base.geometry.height != geom->height)
+		return false;
+
+	if (pixman_region32_contains_rectangle(&view->opaque, &view->extents) != PIXMAN_REGION_IN)
+		return false;
+
+	return can_display_on_plane(view);
+}
+
+/**
+ * Places the top-most views that are not overlapped by any other view onto the
+ * free overlay planes of the screen, as long as the hardware accepts them.
+ */
+static void
+assign_overlays(struct target *target, struct screen *screen, struct compositor_view **views, size_t num_views)
+{
+	struct primary_plane *primary = &screen->planes.primary;
+	const struct swc_rectangle *geom = &screen->base.geometry, *view_geom;
+	pixman_region32_t above;
+	uint32_t index = 0, num_overlays = primary_plane_num_overlays(primary), fb;
+	struct compositor_view *view;
+
+	if (num_overlays == 0)
+		return;
+
+	pixman_region32_init(&above);
+
+	for (; num_views > 0 && index < num_overlays; --num_views) {
+		view = views[num_views - 1];
+		view_geom = &view->base.geometry;
+
+		if (!screen_set_contains(&view->base.screens, target->screen->id))
+			continue;
+
+		if (rectangle_contains_rectangle(geom, view_geom) && can_display_on_plane(view)
+		    && pixman_region32_contains_rectangle(&above, &view->extents) == PIXMAN_REGION_OUT
+		    && drm_get_framebuffer(view->base.buffer, view->base.buffer->format, &fb)
+		    && primary_plane_set_overlay(primary, index, fb, view_geom->x - geom->x, view_geom->y - geom->y,
+		                                 view_geom->width, view_geom->height)) {
+			if (target_hold_buffer(target, view->base.buffer) && target_add_plane_view(target, view)) {
+				screen_set_add(&view->overlays, target->screen->id);
+				++index;
+			} else {
+				primary_plane_set_overlay(primary, index, 0, 0, 0, 0, 0);
+			}
+		}
+
+		pixman_region32_union_rect(&above, &above, view->extents.x1, view->extents.y1,
+		                           view->extents.x2 - view->extents.x1, view->extents.y2 - view->extents.y1);
+	}
+
+	pixman_region32_fini(&above);
+}
+
+/**
+ * Decides which views of the screen are displayed on hardware planes for the
+ * next frame. Returns the view to scan out on the primary plane, if the
+ * top-most view covers the whole screen, or NULL otherwise. The top-most view
+ * is stored in top.
+ */
+static struct compositor_view *
+assign_planes(struct target *target, struct screen *screen, struct compositor_view **top)
+{
+	const struct swc_rectangle *geom = &screen->base.geometry;
+	pixman_box32_t box = { geom->x, geom->y, geom->x + geom->width, geom->y + geom->height };
+	struct compositor_view **views, **old_view, *scanout = NULL;
+	struct wl_array array, old_views;
+	size_t index, num_views;
+
+	/* Drop the client buffers held for a frame that was never displayed. */
+	release_client_buffers(&target->next_client_buffers);
+
+	old_views = target->plane_views;
+	wl_array_init(&target->plane_views);
+	wl_array_for_each (old_view, &old_views) {
+		/* Only keep track of the views that were on overlays. */
+		if (screen_set_contains(&(*old_view)->overlays, target->screen->id))
+			screen_set_remove(&(*old_view)->overlays, target->screen->id);
+		else
+			*old_view = NULL;
+	}
+
+	primary_plane_clear_overlays(&screen->planes.primary);
+
+	wl_array_init(&array);
+	query_views(&box, &array);
+	views = array.data;
+	num_views = array.size / sizeof(*views);
+
+	*top = NULL;
+	for (index = num_views; index > 0; --index) {
+		if (screen_set_contains(&views[index - 1]->base.screens, target->screen->id)) {
+			*top = views[index - 1];
+			if (can_scanout(views[index - 1], geom))
+				scanout = views[index - 1];
+			break;
+		}
+	}
+
+	if (!scanout)
+		assign_overlays(target, screen, views, num_views);
+
+	/* Views that moved onto or off of an overlay need to be repainted, since
+	 * composition now shows (or hides) what is below them. */
+	wl_array_for_each (old_view, &old_views) {
+		if (*old_view && !screen_set_contains(&(*old_view)->overlays, target->screen->id))
+			damage_view(*old_view);
+	}
+	for (index = 0; index < num_views; ++index) {
+		if (screen_set_contains(&views[index]->overlays, target->screen->id)) {
+			bool found = false;
+
+			wl_array_for_each (old_view, &old_views)
+				found |= *old_view == views[index];
+			if (!found)
+				damage_view(views[index]);
+		}
+	}
+
+	wl_array_release(&old_views);
+	wl_array_release(&array);
+
+	return scanout;
+}
+
+static bool
+covers_screen(struct compositor_view *view, struct screen *screen)
+{
+	const struct swc_rectangle *geom = &screen->base.geometry, *view_geom = &view->base.geometry;
+
+	return view_geom->x <= geom->x && view_geom->y <= geom->y
+	    && view_geom->x + view_geom->width >= geom->x + geom->width
+	    && view_geom->y + view_geom->height >= geom->y + geom->height;
+}
+
+/**
+ * Returns whether new frames of the screen should be displayed as soon as
+ * they are ready, either because the window manager allows it for the screen,
+ * or because the client of the view covering it asked for it.
+ */
+static bool
+wants_tearing(struct screen *screen, struct compositor_view *top)
+{
+	if (screen->tearing)
+		return true;
+	return top && top->surface->state.tearing && covers_screen(top, screen);
+}
+
+/**
+ * Returns whether a frame of the target can be painted and queued while the
+ * previous one is waiting for its page flip. This is only done if the frame
+ * being flipped is composited, since the planes can't be reassigned until it
+ * is displayed.
+ */
+static bool
+target_can_queue(struct target *target)
+{
+	return target->screen->queue_depth > 1 && !target->rendering && !target->queued_buffer
+	    && target->plane_views.size == 0 && !target->screen->planes.primary.tearing && !target->resized;
+}
+
+/**
+ * Recreates the buffers of the target at the new geometry of its screen. The
+ * buffer on screen is kept until the first new frame replaces it.
+ */
+static bool
+target_resize(struct target *target)
+{
+	const struct swc_rectangle *geom = &target->screen->base.geometry;
+	struct wld_surface *surface;
+
+	surface = wld_create_surface(swc.drm->context, geom->width, geom->height, WLD_FORMAT_XRGB8888, WLD_DRM_FLAG_SCANOUT);
+
+	if (!surface)
+		return false;
+
+	if (target->old_surface)
+		wld_destroy_surface(target->surface);
+	else
+		target->old_surface = target->surface;
+	target->surface = surface;
+	target->next_buffer = NULL;
+
+	if (target->shadow) {
+		wld_buffer_unreference(target->shadow);
+		target->shadow = wld_create_buffer(swc.shm->context, geom->width, geom->height, WLD_FORMAT_XRGB8888, 0);
+		if (!target->shadow)
+			WARNING("Could not create shadow buffer, compositing into scanout buffers\n");
+	}
+	pixman_region32_reset(&target->shadow_damage, &(pixman_box32_t){ 0, 0, geom->width, geom->height });
+
+	if (target->cache) {
+		wld_buffer_unreference(target->cache);
+		target->cache = NULL;
+	}
+
+	pixman_region32_union_rect(&target->damage, &target->damage, geom->x, geom->y, geom->width, geom->height);
+	target->resized = false;
+
+	return true;
 }
 
 static void
 update_screen(struct screen *screen)
 {
 	struct target *target;
+	struct compositor_view *view, *top;
 	const struct swc_rectangle *geom = &screen->base.geometry;
 	pixman_region32_t damage, *total_damage;
-
-	if (!(compositor.scheduled_updates & screen_mask(screen)))
-		return;
+	struct wld_buffer *buffer;
+	struct wl_array views;
+	bool queue;
+	int ret;
 
 	if (!(target = target_get(screen)))
 		return;
 
+	/* If the screen is waiting on a page flip, the new frame is composited
+	 * into another buffer of the surface and queued behind it. */
+	queue = screen_set_contains(&compositor.pending_flips, screen->id);
+	if (queue) {
+		view = NULL;
+	} else {
+		if (target->resized && !target_resize(target)) {
+			ERROR("Could not resize screen surface\n");
+			return;
+		}
+		view = assign_planes(target, screen, &top);
+		screen->planes.primary.tearing = wants_tearing(screen, top);
+	}
+
 	pixman_region32_init(&damage);
-	pixman_region32_intersect_rect(&damage, &compositor.damage, geom->x, geom->y, geom->width, geom->height);
+	pixman_region32_copy(&damage, &target->damage);
+	pixman_region32_clear(&target->damage);
 	pixman_region32_translate(&damage, -geom->x, -geom->y);
+	damage_limit_screen(&damage);
 	total_damage = wld_surface_damage(target->surface, &damage);
+	if (target->shadow)
+		pixman_region32_union(&target->shadow_damage, &target->shadow_damage, &damage);
+
+	/* If a single view covers the screen, try to display its buffer directly.
+	 * The damage is still added to the surface above so that its buffers are
+	 * up to date when we switch back to composition. */
+	if (view) {
+		if ((ret = target_scanout(target, view)) == 0) {
+			target_take_feedbacks(target, &target->feedbacks);
+			pixman_region32_fini(&damage);
+			screen_set_add(&compositor.pending_flips, screen->id);
+			return;
+		}
+
+		if (ret == -EACCES) {
+			pixman_region32_fini(&damage);
+			swc_deactivate();
+			return;
+		}
 
-	/* Don't repaint the screen if it is waiting for a page flip. */
-	if (compositor.pending_flips & screen_mask(screen)) {
+		DEBUG("Could not scan out view, falling back to composition\n");
+	}
+
+	if (!(buffer = wld_surface_take(target->surface))) {
+		ERROR("Could not get buffer to render to\n");
 		pixman_region32_fini(&damage);
 		return;
 	}
 
-	pixman_region32_t base_damage;
-	pixman_region32_copy(&damage, total_damage);
+	if (queue)
+		target->queued_buffer = buffer;
+	else
+		target->next_buffer = buffer;
+
+	/* With a shadow buffer, only the damage since it was last painted needs
+	 * to be composited, but everything the next buffer missed is copied. */
+	pixman_region32_t base_damage, copy_damage;
+	pixman_region32_init(&copy_damage);
+	if (target->shadow) {
+		pixman_region32_copy(&copy_damage, total_damage);
+		pixman_region32_copy(&damage, &target->shadow_damage);
+		pixman_region32_clear(&target->shadow_damage);
+	} else {
+		pixman_region32_copy(&damage, total_damage);
+	}
 	pixman_region32_translate(&damage, geom->x, geom->y);
 	pixman_region32_init(&base_damage);
 	pixman_region32_subtract(&base_damage, &damage, &compositor.opaque);
-	renderer_repaint(target, &damage, &base_damage, &compositor.views);
+	wl_array_init(&views);
+	query_views(pixman_region32_extents(&damage), &views);
+
+	if (compositor.cache_view && !target_update_cache(target, &damage, &views))
+		WARNING("Could not create render cache\n");
+
+	target_take_feedbacks(target, queue ? &target->queued_feedbacks : &target->feedbacks);
+
+	/* The screen is considered to be waiting on a page flip while the render
+	 * thread paints it, so that it isn't repainted in the meantime. A queued
+	 * frame is presented when the pending page flip completes. */
+	if (compositor.render_thread) {
+		renderer_submit(target, &damage, &base_damage, &views, &copy_damage);
+		screen_set_add(&compositor.pending_flips, screen->id);
+	} else {
+		renderer_repaint(target, &damage, &base_damage, &views, &copy_damage);
+		if (!queue)
+			target_present(target);
+	}
+
+	wl_array_release(&views);
 	pixman_region32_fini(&damage);
 	pixman_region32_fini(&base_damage);
+	pixman_region32_fini(&copy_damage);
+}
 
-	switch (target_swap_buffers(target)) {
-	case -EACCES:
-		/* If we get an EACCES, it is because this session is being deactivated, but
-		 * we haven't yet received the deactivate signal from swc-launch. */
-		swc_deactivate();
-		break;
-	case 0:
-		compositor.pending_flips |= screen_mask(screen);
-		break;
+static void
+handle_render_done(struct render_job *job)
+{
+	struct target *target = wl_container_of(job, target, render_job);
+
+	target->rendering = false;
+
+	/* If the render pool couldn't use one of the buffers, paint with the
+	 * renderer instead. */
+	if (!job->mapped)
+		paint_ops(target, &job->ops, &job->copy_region);
+	release_ops(&job->ops);
+
+	/* A queued frame waits for the page flip of the previous one. */
+	if (target->queued_buffer)
+		return;
+
+	screen_set_remove(&compositor.pending_flips, target->screen->id);
+	target_present(target);
+
+	/* If presenting failed, schedule the updates that were waiting on this
+	 * screen. */
+	schedule_repaint();
+}
+
+static void
+discard_render(struct render_job *job)
+{
+	struct target *target = wl_container_of(job, target, render_job);
+
+	target->rendering = false;
+	release_ops(&job->ops);
+}
+
+/**
+ * Returns the time at which a screen should be repainted, so that the new frame
+ * is ready shortly before the next vertical blank. If the deadline has
+ * passed, or the vertical blank can't be predicted, this is the current time.
+ */
+static uint64_t
+repaint_time(struct screen *screen, uint64_t now)
+{
+	uint64_t vblank;
+
+	/* Screens that may tear are repainted as soon as there is something new
+	 * to show. */
+	if (screen->planes.primary.tearing && swc.drm->async_page_flip)
+		return now;
+
+	/* With a variable refresh rate, the screen waits for the next frame, so
+	 * we repaint as soon as there is something new to show, whether or not a
+	 * fullscreen client is driving it. The driver keeps the refresh rate
+	 * within the range of the panel. */
+	vblank = primary_plane_next_vblank(&screen->planes.primary, now);
+
+	if (vblank < now + compositor.repaint_window)
+		return now;
+	return vblank - compositor.repaint_window;
+}
+
+/**
+ * Fills updates with the scheduled updates that can run, either because their
+ * screens aren't waiting on a page flip, or because a frame can be queued
+ * behind it.
+ */
+static void
+ready_updates(struct screen_set *updates)
+{
+	struct screen *screen;
+	struct target *target;
+
+	screen_set_copy(updates, &compositor.scheduled_updates);
+	screen_set_subtract(updates, &compositor.pending_flips);
+
+	wl_list_for_each (screen, &swc.screens, link) {
+		if (screen_set_contains(&compositor.scheduled_updates, screen->id)
+		    && screen_set_contains(&compositor.pending_flips, screen->id)
+		    && (target = target_get(screen)) && target_can_queue(target))
+			screen_set_add(updates, screen->id);
 	}
 }
 
 static void
-perform_update(void *data)
+perform_update(void)
 {
 	struct screen *screen;
-	uint32_t updates = compositor.scheduled_updates & ~compositor.pending_flips;
+	struct screen_set ready, updates;
+	uint64_t now = get_monotonic_time(), start;
 
-	if (!swc.active || !updates)
+	if (!swc.active)
 		return;
 
+	screen_set_initialize(&ready);
+	screen_set_initialize(&updates);
+	ready_updates(&ready);
+	wl_list_for_each (screen, &swc.screens, link) {
+		if (screen_set_contains(&ready, screen->id) && repaint_time(screen, now) <= now)
+			screen_set_add(&updates, screen->id);
+	}
+
+	if (screen_set_is_empty(&updates))
+		goto done;
+
 	DEBUG("Performing update\n");
 
 	compositor.updating = true;
-	calculate_damage();
-
-	wl_list_for_each (screen, &swc.screens, link)
-		update_screen(screen);
+	calculate_damage(&updates);
+
+	/* Other screens keep their damage until their own deadline. */
+	wl_list_for_each (screen, &swc.screens, link) {
+		if (screen_set_contains(&updates, screen->id)) {
+			start = get_monotonic_time();
+			update_screen(screen);
+			compositor.stats.screen_time += get_monotonic_time() - start;
+			++compositor.stats.screens;
+		}
+	}
 
-	/* XXX: Should assert that all damage was covered by some output */
-	pixman_region32_clear(&compositor.damage);
-	compositor.scheduled_updates &= ~updates;
+	screen_set_subtract(&compositor.scheduled_updates, &updates);
 	compositor.updating = false;
+
+	schedule_repaint();
+
+	compositor.stats.update_time += get_monotonic_time() - now;
+	++compositor.stats.updates;
+
+done:
+	screen_set_finalize(&ready);
+	screen_set_finalize(&updates);
+}
+
+static void
+handle_idle(void *data)
+{
+	compositor.idle_source = NULL;
+	perform_update();
+}
+
+static int
+handle_repaint_timer(int fd, uint32_t mask, void *data)
+{
+	uint64_t expirations;
+
+	if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return 0;
+
+	perform_update();
+	return 0;
+}
+
+/**
+ * Arranges for the scheduled updates that can run to start at the earliest
+ * repaint deadline of their screens.
+ */
+static void
+schedule_repaint(void)
+{
+	struct screen *screen;
+	struct itimerspec timer = { 0 };
+	struct screen_set updates;
+	uint64_t now, time = UINT64_MAX;
+
+	/* If we are in the middle of an update, it reschedules when it's done. */
+	if (compositor.updating)
+		return;
+
+	screen_set_initialize(&updates);
+	ready_updates(&updates);
+
+	now = get_monotonic_time();
+	wl_list_for_each (screen, &swc.screens, link) {
+		if (screen_set_contains(&updates, screen->id))
+			time = MIN(time, repaint_time(screen, now));
+	}
+
+	screen_set_finalize(&updates);
+
+	if (time == UINT64_MAX)
+		return;
+
+	if (time <= now) {
+		if (!compositor.idle_source)
+			compositor.idle_source = wl_event_loop_add_idle(swc.event_loop, &handle_idle, NULL);
+		return;
+	}
+
+	timer.it_value.tv_sec = time / 1000000000;
+	timer.it_value.tv_nsec = time % 1000000000;
+
+	if (timerfd_settime(compositor.repaint_fd, TFD_TIMER_ABSTIME, &timer, NULL) < 0) {
+		WARNING("Could not arm repaint timer: %s\n", strerror(errno));
+		if (!compositor.idle_source)
+			compositor.idle_source = wl_event_loop_add_idle(swc.event_loop, &handle_idle, NULL);
+	}
+}
+
+EXPORT void
+swc_set_repaint_window(uint32_t usec)
+{
+	compositor.repaint_window = usec * 1000ull;
+}
+
+EXPORT void
+swc_get_update_stats(struct swc_update_stats *stats)
+{
+	*stats = compositor.stats;
 }
 
 bool
 handle_motion(struct pointer_handler *handler, uint32_t time, wl_fixed_t fx, wl_fixed_t fy)
 {
-	struct compositor_view *view;
-	bool found = false;
+	struct compositor_view *view = NULL, *candidate;
+	struct grid_entry **entry;
+	struct wl_array *cell;
 	int32_t x = wl_fixed_to_int(fx), y = wl_fixed_to_int(fy);
 	struct swc_rectangle *geom;
 
@@ -693,19 +2296,21 @@ handle_motion(struct pointer_handler *handler, uint32_t time, wl_fixed_t fx, wl_
 	if (swc.seat->pointer->buttons.size > 0)
 		return false;
 
-	wl_list_for_each (view, &compositor.views, link) {
-		if (!view->visible)
-			continue;
-		geom = &view->base.geometry;
-		if (rectangle_contains_point(geom, x, y)) {
-			if (pixman_region32_contains_point(&view->surface->state.input, x - geom->x, y - geom->y, NULL)) {
-				found = true;
-				break;
+	/* Find the top-most view containing the point among those in its grid cell. */
+	if ((cell = grid_cell(&compositor.grid, x, y))) {
+		wl_array_for_each (entry, cell) {
+			candidate = wl_container_of(*entry, candidate, grid_entry);
+			if (view && candidate->order < view->order)
+				continue;
+			geom = &candidate->base.geometry;
+			if (rectangle_contains_point(geom, x, y)) {
+				if (pixman_region32_contains_point(&candidate->surface->state.input, x - geom->x, y - geom->y, NULL))
+					view = candidate;
 			}
 		}
 	}
 
-	pointer_set_focus(swc.seat->pointer, found ? view : NULL);
+	pointer_set_focus(swc.seat->pointer, view);
 
 	return false;
 }
@@ -733,10 +2338,11 @@ handle_swc_event(struct wl_listener *listener, void *data)
 
 	switch (event->type) {
 	case SWC_EVENT_ACTIVATED:
-		schedule_updates(-1);
+		screen_set_clear(&compositor.scheduled_updates);
+		schedule_updates(NULL);
 		break;
 	case SWC_EVENT_DEACTIVATED:
-		compositor.scheduled_updates = 0;
+		screen_set_clear(&compositor.scheduled_updates);
 		break;
 	}
 }
@@ -789,18 +2395,67 @@ bool
 compositor_initialize(void)
 {
 	struct screen *screen;
+	pixman_region32_t screens_region;
+	bool ret;
 	uint32_t keysym;
 
+	/* Index the area covered by the screens. */
+	pixman_region32_init(&screens_region);
+	screens_get_region(&screens_region);
+	ret = grid_initialize(&compositor.grid, pixman_region32_extents(&screens_region), GRID_CELL_SIZE);
+	pixman_region32_fini(&screens_region);
+
+	if (!ret)
+		goto error0;
+
+	compositor.repaint_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+
+	if (compositor.repaint_fd == -1) {
+		ERROR("Could not create repaint timer: %s\n", strerror(errno));
+		goto error1;
+	}
+
+	compositor.repaint_source = wl_event_loop_add_fd(swc.event_loop, compositor.repaint_fd, WL_EVENT_READABLE, &handle_repaint_timer, NULL);
+
+	if (!compositor.repaint_source) {
+		ERROR("Could not create repaint timer event source\n");
+		goto error2;
+	}
+
+#ifdef ENABLE_GLES2
+	compositor.gles2 = getenv(SWC_GLES2_ENV) && gles2_initialize();
+#else
+	compositor.gles2 = false;
+#endif
+
+	/* Only software rendering benefits from splitting work between threads. */
+	if (!compositor.gles2 && (swc.headless || wld_drm_is_dumb(swc.drm->context))) {
+		render_pool_initialize();
+		compositor.render_thread = render_thread_initialize();
+	} else {
+		compositor.render_thread = false;
+	}
+
+	/* Headless screens are already composited in system memory. */
+	compositor.shadow = !compositor.gles2 && !swc.headless && getenv(SWC_SHADOW_ENV) && wld_drm_is_dumb(swc.drm->context);
+	compositor.render_cache = !compositor.gles2 && getenv(SWC_RENDER_CACHE_ENV) && (swc.headless || wld_drm_is_dumb(swc.drm->context));
+	compositor.cache_view = NULL;
+
 	compositor.global = wl_global_create(swc.display, &wl_compositor_interface, 3, NULL, &bind_compositor);
 
 	if (!compositor.global)
-		return false;
-
-	compositor.scheduled_updates = 0;
-	compositor.pending_flips = 0;
+		goto error3;
+
+	compositor.repaint_window = DEFAULT_REPAINT_WINDOW;
+	compositor.idle_source = NULL;
+	screen_set_initialize(&compositor.scheduled_updates);
+	screen_set_initialize(&compositor.pending_flips);
+	screen_set_initialize(&compositor.off_screens);
+	wl_array_init(&compositor.busy_buffers);
 	compositor.updating = false;
-	pixman_region32_init(&compositor.damage);
+	compositor.next_order = 0;
 	pixman_region32_init(&compositor.opaque);
+	compositor.clip_dirty = false;
 	wl_list_init(&compositor.views);
 	wl_signal_init(&swc_compositor.signal.new_surface);
 	compositor.swc_listener.notify = &handle_swc_event;
@@ -809,20 +2464,53 @@ compositor_initialize(void)
 	wl_list_for_each (screen, &swc.screens, link)
 		target_new(screen);
 	if (swc.active)
-		schedule_updates(-1);
+		schedule_updates(NULL);
 
 	swc_add_binding(SWC_BINDING_KEY, SWC_MOD_CTRL | SWC_MOD_ALT, XKB_KEY_BackSpace, &handle_terminate, NULL);
 
-	for (keysym = XKB_KEY_XF86Switch_VT_1; keysym <= XKB_KEY_XF86Switch_VT_12; ++keysym)
-		swc_add_binding(SWC_BINDING_KEY, SWC_MOD_ANY, keysym, &handle_switch_vt, NULL);
+	if (!swc.headless) {
+		for (keysym = XKB_KEY_XF86Switch_VT_1; keysym <= XKB_KEY_XF86Switch_VT_12; ++keysym)
+			swc_add_binding(SWC_BINDING_KEY, SWC_MOD_ANY, keysym, &handle_switch_vt, NULL);
+	}
 
 	return true;
+
+error3:
+	if (compositor.render_thread)
+		render_thread_finalize();
+	render_pool_finalize();
+#ifdef ENABLE_GLES2
+	if (compositor.gles2)
+		gles2_finalize();
+#endif
+	wl_event_source_remove(compositor.repaint_source);
+error2:
+	close(compositor.repaint_fd);
+error1:
+	grid_finalize(&compositor.grid);
+error0:
+	return false;
 }
 
 void
 compositor_finalize(void)
 {
-	pixman_region32_fini(&compositor.damage);
+	if (compositor.render_thread)
+		render_thread_finalize();
 	pixman_region32_fini(&compositor.opaque);
+	wl_array_release(&compositor.busy_buffers);
+	grid_finalize(&compositor.grid);
+	screen_set_finalize(&compositor.scheduled_updates);
+	screen_set_finalize(&compositor.pending_flips);
+	screen_set_finalize(&compositor.off_screens);
+	render_pool_finalize();
+#ifdef ENABLE_GLES2
+	if (compositor.gles2)
+		gles2_finalize();
+#endif
+	if (compositor.idle_source)
+		wl_event_source_remove(compositor.idle_source);
+	wl_event_source_remove(compositor.repaint_source);
+	close(compositor.repaint_fd);
 	wl_global_destroy(compositor.global);
 }
@@ -24,11 +24,15 @@
 #ifndef SWC_COMPOSITOR_H
 #define SWC_COMPOSITOR_H
 
+#include "grid.h"
 #include "view.h"
 
 #include <stdbool.h>
 #include <pixman.h>
 
+#define SWC_SHADOW_ENV "SWC_SHADOW"
+#define SWC_RENDER_CACHE_ENV "SWC_RENDER_CACHE"
+
 struct swc_compositor {
 	struct pointer_handler *const pointer_handler;
 	struct {
@@ -45,6 +49,22 @@ struct swc_compositor {
 bool compositor_initialize(void);
 void compositor_finalize(void);
 
+struct screen;
+struct wld_buffer;
+
+/**
+ * Turns a screen off or back on. Screens that are off are not repainted, and
+ * views that are only on screens that are off get frame events at a low rate.
+ * When a screen is turned back on, all of it is repainted.
+ */
+bool compositor_set_screen_power(struct screen *screen, bool on);
+
+/**
+ * Returns whether a buffer is still in use by the compositor, even though it
+ * may no longer be attached to a view.
+ */
+bool compositor_buffer_in_use(struct wld_buffer *buffer);
+
 struct compositor_view {
 	struct view base;
 	struct surface *surface;
@@ -55,13 +75,48 @@ struct compositor_view {
 	/* Whether or not the view is visible (mapped). */
 	bool visible;
 
+	/* The position of the view in the stacking order. Views with a greater
+	 * order are stacked above views with a lesser order. */
+	uint32_t order;
+
 	/* The box that the surface covers (including it's border). */
 	pixman_box32_t extents;
 
+	/* The entry for this view in the compositor's spatial index. Only visible
+	 * views are indexed. */
+	struct grid_entry grid_entry;
+
 	/* The region that is covered by opaque regions of surfaces above this
 	 * surface. */
 	pixman_region32_t clip;
 
+	/* The opaque region of the surface in global coordinates, as of the last
+	 * time the clip regions were calculated. */
+	pixman_region32_t opaque;
+
+	/* Whether the opaque region covered by this view changed, so the clip
+	 * regions of this view and those below it need to be recalculated. */
+	bool clip_dirty;
+
+	/* The screens on which the view is displayed on an overlay plane rather
+	 * than composited. */
+	struct screen_set overlays;
+
+	/* Whether the view is completely covered by opaque regions of views above
+	 * it, in which case it does not need to be repainted. */
+	bool occluded;
+
+	/* A timer used to send the frame event later in the refresh period, so
+	 * that the client commits its next buffer just before the repaint
+	 * deadline, and the time to send with it. */
+	struct wl_event_source *frame_timer;
+	uint32_t frame_time;
+	bool frame_scheduled;
+
+	/* The minimum time between frame events in nanoseconds, or 0, and the
+	 * time the last one was sent. */
+	uint64_t frame_interval, last_frame;
+
 	struct {
 		uint32_t width;
 		uint32_t color;
@@ -89,4 +144,14 @@ void compositor_view_hide(struct compositor_view *view);
 void compositor_view_set_border_color(struct compositor_view *view, uint32_t color);
 void compositor_view_set_border_width(struct compositor_view *view, uint32_t width);
 
+void compositor_view_set_frame_rate_limit(struct compositor_view *view, uint32_t rate);
+
+/**
+ * Starts or ends an interactive move or resize of a view. With the render
+ * cache enabled, the views below it are kept composited in a cache in the
+ * meantime, so that moving it only repaints it and the views above it.
+ */
+void compositor_view_begin_interaction(struct compositor_view *view);
+void compositor_view_end_interaction(struct compositor_view *view);
+
 #endif
@@ -26,6 +26,7 @@
 #include "event.h"
 #include "internal.h"
 #include "launch.h"
+#include "primary_plane.h"
 #include "screen.h"
 #include "util.h"
 
@@ -40,12 +41,53 @@ update(struct view *view)
 	return true;
 }
 
+/**
+ * Sets the cursor of the CRTC with the legacy cursor ioctl, and of the CRTCs
+ * mirroring it, on a best-effort basis.
+ */
+static int
+set_cursor(struct cursor_plane *plane, uint32_t handle, uint32_t width, uint32_t height)
+{
+	struct mirror *mirror;
+
+	if (drmModeSetCursor(swc.drm->fd, plane->crtc, handle, width, height) < 0)
+		return -errno;
+
+	wl_array_for_each (mirror, &plane->primary->mirrors)
+		drmModeSetCursor(swc.drm->fd, mirror->crtc, handle, width, height);
+
+	return 0;
+}
+
+static int
+move_cursor(struct cursor_plane *plane, int32_t x, int32_t y)
+{
+	struct mirror *mirror;
+
+	if (drmModeMoveCursor(swc.drm->fd, plane->crtc, x, y) < 0)
+		return -errno;
+
+	wl_array_for_each (mirror, &plane->primary->mirrors)
+		drmModeMoveCursor(swc.drm->fd, mirror->crtc, x, y);
+
+	return 0;
+}
+
 static int
 attach(struct view *view, struct wld_buffer *buffer)
 {
 	struct cursor_plane *plane = wl_container_of(view, plane, view);
 
-	if (buffer) {
+	if (primary_plane_has_atomic_cursor(plane->primary)) {
+		uint32_t fb = 0;
+		int ret;
+
+		if (buffer && !drm_get_framebuffer(buffer, WLD_FORMAT_ARGB8888, &fb))
+			return -EINVAL;
+
+		if ((ret = primary_plane_set_cursor(plane->primary, fb, buffer ? buffer->width : 0, buffer ? buffer->height : 0)) < 0)
+			return ret;
+	} else if (buffer) {
 		union wld_object object;
 
 		if (!wld_export(buffer, WLD_DRM_OBJECT_HANDLE, &object)) {
@@ -55,11 +97,11 @@ attach(struct view *view, struct wld_buffer *buffer)
 			return -EINVAL;
 		}
 
-		if (swc.active && drmModeSetCursor(swc.drm->fd, plane->crtc, object.u32, buffer->width, buffer->height) < 0) {
+		if (swc.active && set_cursor(plane, object.u32, buffer->width, buffer->height) < 0) {
 			ERROR("Could not set cursor: %s\n", strerror(errno));
 			return -errno;
 		}
-	} else if (swc.active && drmModeSetCursor(swc.drm->fd, plane->crtc, 0, 0, 0) < 0) {
+	} else if (swc.active && set_cursor(plane, 0, 0, 0) < 0) {
 		ERROR("Could not unset cursor: %s\n", strerror(errno));
 		return -errno;
 	}
@@ -73,7 +115,10 @@ move(struct view *view, int32_t x, int32_t y)
 {
 	struct cursor_plane *plane = wl_container_of(view, plane, view);
 
-	if (swc.active && drmModeMoveCursor(swc.drm->fd, plane->crtc, x - plane->origin->x, y - plane->origin->y) != 0) {
+	if (primary_plane_has_atomic_cursor(plane->primary)) {
+		if (primary_plane_move_cursor(plane->primary, x - plane->origin->x, y - plane->origin->y) < 0)
+			return false;
+	} else if (swc.active && move_cursor(plane, x - plane->origin->x, y - plane->origin->y) != 0) {
 		ERROR("Could not move cursor: %s\n", strerror(errno));
 		return false;
 	}
@@ -89,6 +134,27 @@ static const struct view_impl view_impl = {
 	.move = move,
 };
 
+/* Headless screens have no hardware cursor, so we only track its state. */
+static int
+headless_attach(struct view *view, struct wld_buffer *buffer)
+{
+	view_set_size_from_buffer(view, buffer);
+	return 0;
+}
+
+static bool
+headless_move(struct view *view, int32_t x, int32_t y)
+{
+	view_set_position(view, x, y);
+	return true;
+}
+
+static const struct view_impl headless_view_impl = {
+	.update = update,
+	.attach = headless_attach,
+	.move = headless_move,
+};
+
 static void
 handle_swc_event(struct wl_listener *listener, void *data)
 {
@@ -104,10 +170,17 @@ handle_swc_event(struct wl_listener *listener, void *data)
 }
 
 bool
-cursor_plane_initialize(struct cursor_plane *plane, uint32_t crtc, const struct swc_rectangle *origin)
+cursor_plane_initialize(struct cursor_plane *plane, uint32_t crtc, struct primary_plane *primary, const struct swc_rectangle *origin)
 {
 	plane->origin = origin;
 	plane->crtc = crtc;
+	plane->primary = primary;
+
+	if (swc.headless) {
+		view_initialize(&plane->view, &headless_view_impl);
+		return true;
+	}
+
 	plane->swc_listener.notify = &handle_swc_event;
 	wl_signal_add(&swc.event_signal, &plane->swc_listener);
 	view_initialize(&plane->view, &view_impl);
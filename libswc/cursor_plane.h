@@ -26,14 +26,18 @@
 
 #include "view.h"
 
+struct primary_plane;
+
 struct cursor_plane {
 	struct view view;
 	const struct swc_rectangle *origin;
 	uint32_t crtc;
+	/* With atomic modesetting, the cursor is committed by the primary plane. */
+	struct primary_plane *primary;
 	struct wl_listener swc_listener;
 };
 
-bool cursor_plane_initialize(struct cursor_plane *plane, uint32_t crtc, const struct swc_rectangle *origin);
+bool cursor_plane_initialize(struct cursor_plane *plane, uint32_t crtc, struct primary_plane *primary, const struct swc_rectangle *origin);
 void cursor_plane_finalize(struct cursor_plane *plane);
 
 #endif
@@ -0,0 +1,227 @@
+/* swc: libswc/damage.c
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "swc.h"
+#include "damage.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* The number of times to merge a region before giving up and using its
+ * extents. */
+#define MAX_MERGE_PASSES 4
+
+/* How many times the surface limit the pending damage of a surface may grow
+ * to before it is merged. */
+#define PENDING_SLACK 4
+
+static struct {
+	uint32_t surface_limit, screen_limit;
+	struct swc_damage_stats stats;
+} damage = {
+	.surface_limit = 32,
+	.screen_limit = 64,
+};
+
+static inline int64_t
+box_area(const pixman_box32_t *box)
+{
+	return (int64_t)(box->x2 - box->x1) * (box->y2 - box->y1);
+}
+
+static uint64_t
+region_area(pixman_region32_t *region)
+{
+	pixman_box32_t *boxes;
+	int num_boxes, index;
+	uint64_t area = 0;
+
+	boxes = pixman_region32_rectangles(region, &num_boxes);
+	for (index = 0; index < num_boxes; ++index)
+		area += box_area(&boxes[index]);
+
+	return area;
+}
+
+static inline pixman_box32_t
+box_union(const pixman_box32_t *box1, const pixman_box32_t *box2)
+{
+	return (pixman_box32_t){
+		MIN(box1->x1, box2->x1), MIN(box1->y1, box2->y1),
+		MAX(box1->x2, box2->x2), MAX(box1->y2, box2->y2),
+	};
+}
+
+/* The cost of merging two boxes is the area that would be painted needlessly. */
+static inline int64_t
+merge_cost(const pixman_box32_t *box1, const pixman_box32_t *box2)
+{
+	pixman_box32_t merged = box_union(box1, box2);
+
+	return box_area(&merged) - box_area(box1) - box_area(box2);
+}
+
+static int
+compare_cost(const void *a, const void *b)
+{
+	int64_t cost1 = *(const int64_t *)a, cost2 = *(const int64_t *)b;
+
+	return cost1 < cost2 ? -1 : cost1 > cost2;
+}
+
+/**
+ * Merges neighbouring boxes until there are at most limit boxes.
+ *
+ * In each pass, we find the cost of merging each box with the next one (in
+ * pixman's y-x banded order, so these are usually horizontal or vertical
+ * neighbours), and merge the cheapest pairs. Each pass at least halves the
+ * excess, so only a few passes are needed.
+ */
+static uint32_t
+merge_boxes(pixman_box32_t *boxes, int64_t *costs, uint32_t num_boxes, uint32_t limit)
+{
+	uint32_t index, count, merges, excess;
+	int64_t threshold;
+
+	while (num_boxes > limit) {
+		excess = num_boxes - limit;
+
+		for (index = 0; index < num_boxes - 1; ++index)
+			costs[index] = merge_cost(&boxes[index], &boxes[index + 1]);
+		qsort(costs, num_boxes - 1, sizeof(costs[0]), &compare_cost);
+		threshold = costs[MIN(excess, num_boxes - 1) - 1];
+
+		for (index = 0, count = 0, merges = 0; index < num_boxes; ++count) {
+			if (index + 1 < num_boxes && merges < excess && merge_cost(&boxes[index], &boxes[index + 1]) <= threshold) {
+				boxes[count] = box_union(&boxes[index], &boxes[index + 1]);
+				index += 2;
+				++merges;
+			} else {
+				boxes[count] = boxes[index++];
+			}
+		}
+
+		num_boxes = count;
+	}
+
+	return num_boxes;
+}
+
+/**
+ * Merges the boxes of a region once, and replaces the region with their union.
+ * Returns false if we ran out of memory.
+ */
+static bool
+merge_region(pixman_region32_t *region, uint32_t limit)
+{
+	pixman_box32_t *boxes;
+	int64_t *costs;
+	int num_boxes;
+
+	pixman_region32_rectangles(region, &num_boxes);
+	costs = malloc((num_boxes - 1) * sizeof(costs[0]));
+	boxes = costs ? malloc(num_boxes * sizeof(boxes[0])) : NULL;
+
+	if (boxes) {
+		memcpy(boxes, pixman_region32_rectangles(region, NULL), num_boxes * sizeof(boxes[0]));
+		num_boxes = merge_boxes(boxes, costs, num_boxes, limit);
+		pixman_region32_fini(region);
+		pixman_region32_init_rects(region, boxes, num_boxes);
+	}
+
+	free(boxes);
+	free(costs);
+
+	return boxes != NULL;
+}
+
+static void
+limit_region(pixman_region32_t *region, uint32_t limit)
+{
+	pixman_box32_t extents;
+	uint32_t pass;
+	int num_boxes;
+	uint64_t area;
+
+	pixman_region32_rectangles(region, &num_boxes);
+	if (limit == 0 || (uint32_t)num_boxes <= limit)
+		return;
+
+	++damage.stats.simplified;
+	damage.stats.boxes_before += num_boxes;
+	area = region_area(region);
+
+	/* Merged boxes may overlap, in which case their union is split into
+	 * bands again and can have more boxes than the limit. Merging those
+	 * again usually gets below it within a few passes. */
+	for (pass = 0; pass < MAX_MERGE_PASSES && (uint32_t)pixman_region32_n_rects(region) > limit; ++pass) {
+		if (!merge_region(region, limit))
+			break;
+	}
+
+	/* If that didn't work, or we ran out of memory, just use the extents. */
+	if ((uint32_t)pixman_region32_n_rects(region) > limit) {
+		extents = *pixman_region32_extents(region);
+		pixman_region32_fini(region);
+		pixman_region32_init_with_extents(region, &extents);
+	}
+
+	damage.stats.boxes_after += pixman_region32_n_rects(region);
+	damage.stats.wasted_area += region_area(region) - area;
+}
+
+void
+damage_limit_surface(pixman_region32_t *region)
+{
+	limit_region(region, damage.surface_limit);
+}
+
+void
+damage_limit_pending(pixman_region32_t *region)
+{
+	/* Merging on every request would be slow for clients that send many
+	 * small rectangles, so let the region grow to a few times the limit
+	 * first. */
+	if ((uint32_t)pixman_region32_n_rects(region) > damage.surface_limit * PENDING_SLACK)
+		limit_region(region, damage.surface_limit);
+}
+
+void
+damage_limit_screen(pixman_region32_t *region)
+{
+	limit_region(region, damage.screen_limit);
+}
+
+EXPORT void
+swc_set_damage_limits(uint32_t surface_limit, uint32_t screen_limit)
+{
+	damage.surface_limit = surface_limit;
+	damage.screen_limit = screen_limit;
+}
+
+EXPORT void
+swc_get_damage_stats(struct swc_damage_stats *stats)
+{
+	*stats = damage.stats;
+}
@@ -0,0 +1,44 @@
+/* swc: libswc/damage.h
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SWC_DAMAGE_H
+#define SWC_DAMAGE_H
+
+#include <pixman.h>
+
+/**
+ * Damage regions with many rectangles make every region operation during a
+ * repaint slow. These limit the number of rectangles in the damage of a
+ * surface or screen by merging rectangles that are close together, at the
+ * cost of repainting some undamaged pixels.
+ */
+void damage_limit_surface(pixman_region32_t *damage);
+void damage_limit_screen(pixman_region32_t *damage);
+
+/**
+ * Keeps the damage that a client accumulates before committing from growing
+ * without bound, without merging it on every request.
+ */
+void damage_limit_pending(pixman_region32_t *damage);
+
+#endif
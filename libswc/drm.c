@@ -44,12 +44,59 @@
 #include <wayland-server.h>
 #include "wayland-drm-server-protocol.h"
 
+/* Older versions of libdrm don't know about asynchronous atomic commits. */
+#ifndef DRM_CAP_ATOMIC_ASYNC_PAGE_FLIP
+# define DRM_CAP_ATOMIC_ASYNC_PAGE_FLIP 0x15
+#endif
+
+enum {
+	WLD_USER_OBJECT_FRAMEBUFFER = WLD_USER_ID
+};
+
+/* The framebuffers created for a buffer. A buffer may be displayed with
+ * different formats on different planes, for example without alpha on the
+ * primary plane and with it on an overlay, so there is one for each format. */
+struct framebuffer {
+	struct wld_exporter exporter;
+	struct wld_destructor destructor;
+	struct wl_array ids;
+};
+
+struct framebuffer_id {
+	uint32_t format, id;
+};
+
+static const char *const crtc_property_names[] = {
+	[DRM_CRTC_PROPERTY_ACTIVE] = "ACTIVE",
+	[DRM_CRTC_PROPERTY_MODE_ID] = "MODE_ID",
+};
+
+static const char *const connector_property_names[] = {
+	[DRM_CONNECTOR_PROPERTY_CRTC_ID] = "CRTC_ID",
+};
+
+static const char *const plane_property_names[] = {
+	[DRM_PLANE_PROPERTY_TYPE] = "type",
+	[DRM_PLANE_PROPERTY_FB_ID] = "FB_ID",
+	[DRM_PLANE_PROPERTY_CRTC_ID] = "CRTC_ID",
+	[DRM_PLANE_PROPERTY_SRC_X] = "SRC_X",
+	[DRM_PLANE_PROPERTY_SRC_Y] = "SRC_Y",
+	[DRM_PLANE_PROPERTY_SRC_W] = "SRC_W",
+	[DRM_PLANE_PROPERTY_SRC_H] = "SRC_H",
+	[DRM_PLANE_PROPERTY_CRTC_X] = "CRTC_X",
+	[DRM_PLANE_PROPERTY_CRTC_Y] = "CRTC_Y",
+	[DRM_PLANE_PROPERTY_CRTC_W] = "CRTC_W",
+	[DRM_PLANE_PROPERTY_CRTC_H] = "CRTC_H",
+};
+
 struct swc_drm swc_drm;
 
 static struct {
 	char *path;
 
-	uint32_t taken_ids;
+	/* The ID of the next screen. */
+	uint32_t next_id;
+	struct wl_array taken_planes;
 
 	struct wl_global *global;
 	struct wl_event_source *event_source;
@@ -192,36 +239,257 @@ find_available_crtc(drmModeRes *resources, drmModeConnector *connector, uint32_t
 	return false;
 }
 
+static void
+handle_vblank(int fd, unsigned int sequence, unsigned int sec, unsigned int usec, void *data)
+{
+}
+
+static void
+handle_page_flip(int fd, unsigned int sequence, unsigned int sec, unsigned int usec, unsigned int crtc, void *data)
+{
+	struct drm_handler *handler = data;
+
+	handler->page_flip(handler, crtc, sec * 1000000000ull + usec * 1000ull, sequence);
+}
+
+static drmEventContext event_context = {
+	.version = DRM_EVENT_CONTEXT_VERSION,
+	.vblank_handler = handle_vblank,
+	.page_flip_handler2 = handle_page_flip,
+};
+
 static bool
-find_available_id(uint32_t *id)
+framebuffer_export(struct wld_exporter *exporter, struct wld_buffer *buffer, uint32_t type, union wld_object *object)
 {
-	uint32_t index = __builtin_ffsl(~drm.taken_ids);
+	struct framebuffer *framebuffer = wl_container_of(exporter, framebuffer, exporter);
 
-	if (index == 0)
+	switch (type) {
+	case WLD_USER_OBJECT_FRAMEBUFFER:
+		object->ptr = framebuffer;
+		break;
+	default:
 		return false;
+	}
 
-	*id = index - 1;
 	return true;
 }
 
 static void
-handle_vblank(int fd, unsigned int sequence, unsigned int sec, unsigned int usec, void *data)
+framebuffer_destroy(struct wld_destructor *destructor)
 {
+	struct framebuffer *framebuffer = wl_container_of(destructor, framebuffer, destructor);
+	struct framebuffer_id *entry;
+
+	wl_array_for_each (entry, &framebuffer->ids)
+		drmModeRmFB(swc.drm->fd, entry->id);
+	wl_array_release(&framebuffer->ids);
+	free(framebuffer);
 }
 
-static void
-handle_page_flip(int fd, unsigned int sequence, unsigned int sec, unsigned int usec, void *data)
+bool
+drm_get_framebuffer(struct wld_buffer *buffer, uint32_t format, uint32_t *id)
 {
-	struct drm_handler *handler = data;
+	struct framebuffer *framebuffer;
+	struct framebuffer_id *entry;
+	union wld_object object;
+	uint32_t handles[4] = { 0 }, pitches[4] = { 0 }, offsets[4] = { 0 };
+
+	if (wld_export(buffer, WLD_USER_OBJECT_FRAMEBUFFER, &object)) {
+		framebuffer = object.ptr;
+		wl_array_for_each (entry, &framebuffer->ids) {
+			if (entry->format == format) {
+				*id = entry->id;
+				return true;
+			}
+		}
+	} else {
+		if (!(framebuffer = malloc(sizeof(*framebuffer))))
+			return false;
+		wl_array_init(&framebuffer->ids);
+		framebuffer->exporter.export = &framebuffer_export;
+		wld_buffer_add_exporter(buffer, &framebuffer->exporter);
+		framebuffer->destructor.destroy = &framebuffer_destroy;
+		wld_buffer_add_destructor(buffer, &framebuffer->destructor);
+	}
+
+	if (!wld_export(buffer, WLD_DRM_OBJECT_HANDLE, &object)) {
+		ERROR("Could not get buffer handle\n");
+		return false;
+	}
+
+	if (!(entry = wl_array_add(&framebuffer->ids, sizeof(*entry))))
+		return false;
+
+	handles[0] = object.u32;
+	pitches[0] = buffer->pitch;
+
+	if (drmModeAddFB2(swc.drm->fd, buffer->width, buffer->height, format, handles, pitches, offsets, &entry->id, 0) < 0) {
+		ERROR("Could not create framebuffer: %s\n", strerror(errno));
+		framebuffer->ids.size -= sizeof(*entry);
+		return false;
+	}
 
-	handler->page_flip(handler, sec * 1000 + usec / 1000);
+	entry->format = format;
+	*id = entry->id;
+
+	return true;
 }
 
-static drmEventContext event_context = {
-	.version = DRM_EVENT_CONTEXT_VERSION,
-	.vblank_handler = handle_vblank,
-	.page_flip_handler = handle_page_flip,
-};
+static bool
+get_properties(uint32_t object, uint32_t type, const char *const names[], uint32_t *properties, uint64_t *values, size_t count)
+{
+	drmModeObjectProperties *object_properties;
+	drmModePropertyRes *property;
+	uint32_t i, j;
+	size_t found = 0;
+
+	if (!(object_properties = drmModeObjectGetProperties(swc.drm->fd, object, type)))
+		return false;
+
+	memset(properties, 0, count * sizeof(properties[0]));
+
+	for (i = 0; i < object_properties->count_props; ++i) {
+		if (!(property = drmModeGetProperty(swc.drm->fd, object_properties->props[i])))
+			continue;
+
+		for (j = 0; j < count; ++j) {
+			if (strcmp(property->name, names[j]) == 0) {
+				properties[j] = property->prop_id;
+				if (values)
+					values[j] = object_properties->prop_values[i];
+				++found;
+				break;
+			}
+		}
+
+		drmModeFreeProperty(property);
+	}
+
+	drmModeFreeObjectProperties(object_properties);
+
+	return found == count;
+}
+
+bool
+drm_get_crtc_properties(uint32_t crtc, uint32_t properties[static DRM_CRTC_NUM_PROPERTIES])
+{
+	return get_properties(crtc, DRM_MODE_OBJECT_CRTC, crtc_property_names, properties, NULL, DRM_CRTC_NUM_PROPERTIES);
+}
+
+bool
+drm_get_connector_properties(uint32_t connector, uint32_t properties[static DRM_CONNECTOR_NUM_PROPERTIES])
+{
+	return get_properties(connector, DRM_MODE_OBJECT_CONNECTOR, connector_property_names, properties, NULL, DRM_CONNECTOR_NUM_PROPERTIES);
+}
+
+bool
+drm_get_property(uint32_t object, uint32_t type, const char *name, uint32_t *property, uint64_t *value)
+{
+	return get_properties(object, type, &name, property, value, 1);
+}
+
+static bool
+plane_is_taken(uint32_t id)
+{
+	uint32_t *taken;
+
+	wl_array_for_each (taken, &drm.taken_planes) {
+		if (*taken == id)
+			return true;
+	}
+
+	return false;
+}
+
+bool
+drm_find_plane(uint32_t crtc, uint64_t type, struct drm_plane *plane)
+{
+	drmModeRes *resources;
+	drmModePlaneRes *plane_resources;
+	drmModePlane *info;
+	uint64_t values[DRM_PLANE_NUM_PROPERTIES];
+	uint32_t i, crtc_mask = 0, *taken;
+	bool found = false;
+
+	if (!(resources = drmModeGetResources(swc.drm->fd)))
+		return false;
+
+	for (i = 0; i < resources->count_crtcs; ++i) {
+		if (resources->crtcs[i] == crtc)
+			crtc_mask = 1 << i;
+	}
+
+	drmModeFreeResources(resources);
+
+	if (!(plane_resources = drmModeGetPlaneResources(swc.drm->fd)))
+		return false;
+
+	for (i = 0; i < plane_resources->count_planes && !found; ++i) {
+		if (plane_is_taken(plane_resources->planes[i]))
+			continue;
+
+		if (!(info = drmModeGetPlane(swc.drm->fd, plane_resources->planes[i])))
+			continue;
+
+		if (info->possible_crtcs & crtc_mask
+		    && get_properties(info->plane_id, DRM_MODE_OBJECT_PLANE, plane_property_names, plane->properties, values, DRM_PLANE_NUM_PROPERTIES)
+		    && values[DRM_PLANE_PROPERTY_TYPE] == type) {
+			plane->id = info->plane_id;
+			found = true;
+		}
+
+		drmModeFreePlane(info);
+	}
+
+	drmModeFreePlaneResources(plane_resources);
+
+	if (!found || !(taken = wl_array_add(&drm.taken_planes, sizeof(*taken))))
+		return false;
+
+	*taken = plane->id;
+
+	return true;
+}
+
+void
+drm_release_plane(struct drm_plane *plane)
+{
+	uint32_t *taken;
+
+	wl_array_for_each (taken, &drm.taken_planes) {
+		if (*taken == plane->id) {
+			array_remove(&drm.taken_planes, taken, sizeof(*taken));
+			break;
+		}
+	}
+}
+
+bool
+drm_plane_add(drmModeAtomicReq *req, const struct drm_plane *plane, uint32_t crtc, uint32_t fb,
+              int32_t x, int32_t y, uint32_t width, uint32_t height)
+{
+	const uint32_t *properties = plane->properties;
+	bool ret = true;
+
+	if (!fb) {
+		ret &= drmModeAtomicAddProperty(req, plane->id, properties[DRM_PLANE_PROPERTY_FB_ID], 0) >= 0;
+		ret &= drmModeAtomicAddProperty(req, plane->id, properties[DRM_PLANE_PROPERTY_CRTC_ID], 0) >= 0;
+		return ret;
+	}
+
+	ret &= drmModeAtomicAddProperty(req, plane->id, properties[DRM_PLANE_PROPERTY_FB_ID], fb) >= 0;
+	ret &= drmModeAtomicAddProperty(req, plane->id, properties[DRM_PLANE_PROPERTY_CRTC_ID], crtc) >= 0;
+	ret &= drmModeAtomicAddProperty(req, plane->id, properties[DRM_PLANE_PROPERTY_SRC_X], 0) >= 0;
+	ret &= drmModeAtomicAddProperty(req, plane->id, properties[DRM_PLANE_PROPERTY_SRC_Y], 0) >= 0;
+	ret &= drmModeAtomicAddProperty(req, plane->id, properties[DRM_PLANE_PROPERTY_SRC_W], (uint64_t)width << 16) >= 0;
+	ret &= drmModeAtomicAddProperty(req, plane->id, properties[DRM_PLANE_PROPERTY_SRC_H], (uint64_t)height << 16) >= 0;
+	ret &= drmModeAtomicAddProperty(req, plane->id, properties[DRM_PLANE_PROPERTY_CRTC_X], x) >= 0;
+	ret &= drmModeAtomicAddProperty(req, plane->id, properties[DRM_PLANE_PROPERTY_CRTC_Y], y) >= 0;
+	ret &= drmModeAtomicAddProperty(req, plane->id, properties[DRM_PLANE_PROPERTY_CRTC_W], width) >= 0;
+	ret &= drmModeAtomicAddProperty(req, plane->id, properties[DRM_PLANE_PROPERTY_CRTC_H], height) >= 0;
+
+	return ret;
+}
 
 static int
 handle_data(int fd, uint32_t mask, void *data)
@@ -260,18 +528,23 @@ drm_initialize(void)
 		goto error0;
 	}
 
-	drm.taken_ids = 0;
+	drm.next_id = 0;
+	wl_array_init(&drm.taken_planes);
 	swc.drm->fd = launch_open_device(primary, O_RDWR | O_CLOEXEC);
 	if (swc.drm->fd == -1) {
 		ERROR("Could not open DRM device at %s\n", primary);
 		goto error0;
 	}
+	swc.drm->atomic = getenv(SWC_ATOMIC_ENV) && drmSetClientCap(swc.drm->fd, DRM_CLIENT_CAP_ATOMIC, 1) == 0;
+	DEBUG("Using %s modesetting\n", swc.drm->atomic ? "atomic" : "legacy");
 	if (drmGetCap(swc.drm->fd, DRM_CAP_CURSOR_WIDTH, &val) < 0)
 		val = 64;
 	swc.drm->cursor_w = val;
 	if (drmGetCap(swc.drm->fd, DRM_CAP_CURSOR_HEIGHT, &val) < 0)
 		val = 64;
 	swc.drm->cursor_h = val;
+	swc.drm->async_page_flip = drmGetCap(swc.drm->fd, swc.drm->atomic ? DRM_CAP_ATOMIC_ASYNC_PAGE_FLIP : DRM_CAP_ASYNC_PAGE_FLIP, &val) == 0 && val;
+	DEBUG("Asynchronous page flips are %ssupported\n", swc.drm->async_page_flip ? "" : "not ");
 
 	drm.path = drmGetRenderDeviceNameFromFd(swc.drm->fd);
 	if (!drm.path) {
@@ -328,9 +601,52 @@ drm_finalize(void)
 	wld_destroy_renderer(swc.drm->renderer);
 	wld_destroy_context(swc.drm->context);
 	free(drm.path);
+	wl_array_release(&drm.taken_planes);
 	close(swc.drm->fd);
 }
 
+/**
+ * Finds a mode of an output with the same size as the specified mode,
+ * preferring one with the same refresh rate.
+ */
+static struct mode *
+find_mirror_mode(struct output *output, const struct mode *mode)
+{
+	struct mode *candidate, *found = NULL;
+
+	wl_array_for_each (candidate, &output->modes) {
+		if (candidate->width != mode->width || candidate->height != mode->height)
+			continue;
+		if (candidate->refresh == mode->refresh)
+			return candidate;
+		if (!found)
+			found = candidate;
+	}
+
+	return found;
+}
+
+/**
+ * Attempts to display a screen on an output with another CRTC, so that it is
+ * composited only once.
+ */
+static bool
+add_mirror(struct screen *screen, struct output *output, uint32_t crtc)
+{
+	struct mode *mode;
+
+	if (!(mode = find_mirror_mode(output, &screen->planes.primary.mode)))
+		return false;
+
+	if (!primary_plane_add_mirror(&screen->planes.primary, crtc, output->connector, mode))
+		return false;
+
+	output->screen = screen;
+	wl_list_insert(screen->outputs.prev, &output->link);
+
+	return true;
+}
+
 bool
 drm_create_screens(struct wl_list *screens)
 {
@@ -338,7 +654,9 @@ drm_create_screens(struct wl_list *screens)
 	drmModeConnector *connector;
 	int i;
 	struct output *output;
+	struct screen *mirrored = NULL;
 	uint32_t taken_crtcs = 0;
+	bool mirror = getenv(SWC_MIRROR_ENV) != NULL;
 
 	if (!(resources = drmModeGetResources(swc.drm->fd))) {
 		ERROR("Could not get DRM resources\n");
@@ -350,27 +668,32 @@ drm_create_screens(struct wl_list *screens)
 
 		if (connector->connection == DRM_MODE_CONNECTED) {
 			int crtc_index;
-			uint32_t id;
 
 			if (!find_available_crtc(resources, connector, taken_crtcs, &crtc_index)) {
 				WARNING("Could not find CRTC for connector %d\n", i);
 				continue;
 			}
 
-			if (!find_available_id(&id)) {
-				WARNING("No more available output IDs\n");
-				drmModeFreeConnector(connector);
-				break;
-			}
-
 			if (!(output = output_new(connector)))
 				continue;
 
+			/* In mirror mode, every connector shows the first screen if it
+			 * has a mode of the same size. */
+			if (mirrored) {
+				if (add_mirror(mirrored, output, resources->crtcs[crtc_index])) {
+					taken_crtcs |= 1 << crtc_index;
+					continue;
+				}
+				WARNING("Could not mirror screen on connector %d\n", i);
+			}
+
 			output->screen = screen_new(resources->crtcs[crtc_index], output);
-			output->screen->id = id;
+			output->screen->id = drm.next_id++;
 
 			taken_crtcs |= 1 << crtc_index;
-			drm.taken_ids |= 1 << id;
+
+			if (mirror && !mirrored)
+				mirrored = output->screen;
 
 			wl_list_insert(screens, &output->screen->link);
 		}
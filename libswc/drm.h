@@ -3,23 +3,102 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <xf86drmMode.h>
+
+#define SWC_ATOMIC_ENV "SWC_ATOMIC"
+#define SWC_MIRROR_ENV "SWC_MIRROR"
 
 struct wl_list;
+struct wld_buffer;
 
 struct drm_handler {
-	void (*page_flip)(struct drm_handler *handler, uint32_t time);
+	/* Called when a page flip of a CRTC completes, with the time of the
+	 * vertical blank in nanoseconds on the monotonic clock, and the CRTC's
+	 * vertical blank counter. */
+	void (*page_flip)(struct drm_handler *handler, uint32_t crtc, uint64_t time, uint32_t sequence);
 };
 
 struct swc_drm {
 	int fd;
 	uint32_t cursor_w, cursor_h;
+	/* Whether the device supports atomic modesetting. */
+	bool atomic;
+	/* Whether page flips can happen immediately instead of at the vertical
+	 * blank. */
+	bool async_page_flip;
 	struct wld_context *context;
 	struct wld_renderer *renderer;
 };
 
+enum drm_crtc_property {
+	DRM_CRTC_PROPERTY_ACTIVE,
+	DRM_CRTC_PROPERTY_MODE_ID,
+	DRM_CRTC_NUM_PROPERTIES
+};
+
+enum drm_connector_property {
+	DRM_CONNECTOR_PROPERTY_CRTC_ID,
+	DRM_CONNECTOR_NUM_PROPERTIES
+};
+
+enum drm_plane_property {
+	DRM_PLANE_PROPERTY_TYPE,
+	DRM_PLANE_PROPERTY_FB_ID,
+	DRM_PLANE_PROPERTY_CRTC_ID,
+	DRM_PLANE_PROPERTY_SRC_X,
+	DRM_PLANE_PROPERTY_SRC_Y,
+	DRM_PLANE_PROPERTY_SRC_W,
+	DRM_PLANE_PROPERTY_SRC_H,
+	DRM_PLANE_PROPERTY_CRTC_X,
+	DRM_PLANE_PROPERTY_CRTC_Y,
+	DRM_PLANE_PROPERTY_CRTC_W,
+	DRM_PLANE_PROPERTY_CRTC_H,
+	DRM_PLANE_NUM_PROPERTIES
+};
+
+struct drm_plane {
+	uint32_t id;
+	uint32_t properties[DRM_PLANE_NUM_PROPERTIES];
+};
+
 bool drm_initialize(void);
 void drm_finalize(void);
 
 bool drm_create_screens(struct wl_list *screens);
 
+/**
+ * Returns the ID of a framebuffer for the buffer with the specified format,
+ * creating it if necessary. The framebuffers of a buffer are destroyed along
+ * with it.
+ */
+bool drm_get_framebuffer(struct wld_buffer *buffer, uint32_t format, uint32_t *id);
+
+/**
+ * Looks up the IDs of the atomic properties of a CRTC or connector. Returns
+ * false if any of them are missing.
+ */
+bool drm_get_crtc_properties(uint32_t crtc, uint32_t properties[static DRM_CRTC_NUM_PROPERTIES]);
+bool drm_get_connector_properties(uint32_t connector, uint32_t properties[static DRM_CONNECTOR_NUM_PROPERTIES]);
+
+/**
+ * Looks up the ID and, if value is not NULL, the value of a single property
+ * of an object (DRM_MODE_OBJECT_*) that drivers may not provide.
+ */
+bool drm_get_property(uint32_t object, uint32_t type, const char *name, uint32_t *property, uint64_t *value);
+
+/**
+ * Finds a plane of the specified type (DRM_PLANE_TYPE_*) that can be used
+ * with the CRTC and is not in use by another screen, and claims it.
+ */
+bool drm_find_plane(uint32_t crtc, uint64_t type, struct drm_plane *plane);
+void drm_release_plane(struct drm_plane *plane);
+
+/**
+ * Adds the properties needed to display a framebuffer on a plane at the
+ * specified CRTC coordinates to an atomic request. If fb is 0, the plane is
+ * disabled instead.
+ */
+bool drm_plane_add(drmModeAtomicReq *req, const struct drm_plane *plane, uint32_t crtc, uint32_t fb,
+                   int32_t x, int32_t y, uint32_t width, uint32_t height);
+
 #endif
@@ -0,0 +1,681 @@
+/* swc: libswc/gles2.c
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gles2.h"
+#include "render_pool.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <wayland-util.h>
+#include <wld/wld.h>
+#include <wld/drm.h>
+
+enum {
+	ATTRIB_POSITION,
+	ATTRIB_TEXCOORD,
+};
+
+struct gles2_buffer {
+	struct wld_buffer *buffer;
+	struct wld_destructor destructor;
+
+	/* The texture holding the contents of the buffer, and the EGL image it
+	 * was created from, or EGL_NO_IMAGE_KHR if it is uploaded from memory. */
+	GLuint texture;
+	EGLImageKHR image;
+
+	/* The framebuffer used to render into the buffer, and for imported
+	 * buffers, its renderbuffer. */
+	GLuint framebuffer, renderbuffer;
+
+	struct wl_list link;
+};
+
+static struct {
+	EGLDisplay display;
+	EGLContext context;
+
+	PFNEGLCREATEIMAGEKHRPROC create_image;
+	PFNEGLDESTROYIMAGEKHRPROC destroy_image;
+	PFNGLEGLIMAGETARGETTEXTURE2DOESPROC image_target_texture;
+	PFNGLEGLIMAGETARGETRENDERBUFFERSTORAGEOESPROC image_target_renderbuffer;
+	bool dmabuf_import, unpack_subimage, read_bgra;
+
+	GLuint program;
+	GLint size;
+
+	struct wl_list buffers;
+
+	/* Memory that pixels are read back into. */
+	void *pixels;
+	size_t pixels_size;
+} gles2 = {
+	.display = EGL_NO_DISPLAY,
+};
+
+static const char vertex_shader[] =
+	"uniform vec2 size;\n"
+	"attribute vec2 position;\n"
+	"attribute vec2 texcoord;\n"
+	"varying vec2 v_texcoord;\n"
+	"void main() {\n"
+	"	gl_Position = vec4(position / size * 2.0 - 1.0, 0.0, 1.0);\n"
+	"	v_texcoord = texcoord;\n"
+	"}\n";
+
+static const char fragment_shader[] =
+	"precision mediump float;\n"
+	"uniform sampler2D tex;\n"
+	"varying vec2 v_texcoord;\n"
+	"void main() {\n"
+	"	gl_FragColor = texture2D(tex, v_texcoord);\n"
+	"}\n";
+
+static bool
+has_extension(const char *extensions, const char *name)
+{
+	size_t length = strlen(name), token;
+
+	if (!extensions)
+		return false;
+
+	for (;;) {
+		token = strcspn(extensions, " ");
+		if (token == length && memcmp(extensions, name, length) == 0)
+			return true;
+		extensions += token;
+		if (*extensions == '\0')
+			return false;
+		++extensions;
+	}
+}
+
+static bool
+supported_format(uint32_t format)
+{
+	return format == WLD_FORMAT_XRGB8888 || format == WLD_FORMAT_ARGB8888;
+}
+
+static GLuint
+compile_shader(GLenum type, const char *source)
+{
+	GLuint shader;
+	GLint status;
+	char log[512];
+
+	if (!(shader = glCreateShader(type)))
+		return 0;
+
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+
+	if (!status) {
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		ERROR("Could not compile shader: %s\n", log);
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+static bool
+create_program(void)
+{
+	GLuint vertex, fragment;
+	GLint status;
+
+	if (!(vertex = compile_shader(GL_VERTEX_SHADER, vertex_shader)))
+		goto error0;
+	if (!(fragment = compile_shader(GL_FRAGMENT_SHADER, fragment_shader)))
+		goto error1;
+	if (!(gles2.program = glCreateProgram()))
+		goto error2;
+
+	glAttachShader(gles2.program, vertex);
+	glAttachShader(gles2.program, fragment);
+	glBindAttribLocation(gles2.program, ATTRIB_POSITION, "position");
+	glBindAttribLocation(gles2.program, ATTRIB_TEXCOORD, "texcoord");
+	glLinkProgram(gles2.program);
+	glGetProgramiv(gles2.program, GL_LINK_STATUS, &status);
+
+	if (!status) {
+		ERROR("Could not link shader program\n");
+		goto error3;
+	}
+
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+
+	glUseProgram(gles2.program);
+	glUniform1i(glGetUniformLocation(gles2.program, "tex"), 0);
+	gles2.size = glGetUniformLocation(gles2.program, "size");
+
+	return true;
+
+error3:
+	glDeleteProgram(gles2.program);
+error2:
+	glDeleteShader(fragment);
+error1:
+	glDeleteShader(vertex);
+error0:
+	return false;
+}
+
+static void
+destroy_objects(struct gles2_buffer *entry)
+{
+	if (entry->framebuffer)
+		glDeleteFramebuffers(1, &entry->framebuffer);
+	if (entry->renderbuffer)
+		glDeleteRenderbuffers(1, &entry->renderbuffer);
+	if (entry->texture)
+		glDeleteTextures(1, &entry->texture);
+	if (entry->image != EGL_NO_IMAGE_KHR)
+		gles2.destroy_image(gles2.display, entry->image);
+
+	entry->framebuffer = 0;
+	entry->renderbuffer = 0;
+	entry->texture = 0;
+	entry->image = EGL_NO_IMAGE_KHR;
+}
+
+static void
+handle_buffer_destroy(struct wld_destructor *destructor)
+{
+	struct gles2_buffer *entry = wl_container_of(destructor, entry, destructor);
+
+	/* The buffer may outlive the renderer, in which case its objects have
+	 * already been destroyed. */
+	if (gles2.display != EGL_NO_DISPLAY)
+		destroy_objects(entry);
+	wl_list_remove(&entry->link);
+	free(entry);
+}
+
+static struct gles2_buffer *
+find_buffer(struct wld_buffer *buffer, bool create)
+{
+	struct gles2_buffer *entry;
+
+	wl_list_for_each (entry, &gles2.buffers, link) {
+		if (entry->buffer == buffer)
+			return entry;
+	}
+
+	if (!create || !(entry = malloc(sizeof(*entry))))
+		return NULL;
+
+	entry->buffer = buffer;
+	entry->texture = 0;
+	entry->image = EGL_NO_IMAGE_KHR;
+	entry->framebuffer = 0;
+	entry->renderbuffer = 0;
+	entry->destructor.destroy = &handle_buffer_destroy;
+	wld_buffer_add_destructor(buffer, &entry->destructor);
+	wl_list_insert(&gles2.buffers, &entry->link);
+
+	return entry;
+}
+
+/**
+ * Creates an EGL image for the buffer from its DMA-BUF.
+ */
+static bool
+import_image(struct gles2_buffer *entry)
+{
+	struct wld_buffer *buffer = entry->buffer;
+	union wld_object object;
+
+	if (entry->image != EGL_NO_IMAGE_KHR)
+		return true;
+	if (!gles2.dmabuf_import || !wld_export(buffer, WLD_DRM_OBJECT_PRIME_FD, &object))
+		return false;
+
+	const EGLint attribs[] = {
+		EGL_WIDTH, buffer->width,
+		EGL_HEIGHT, buffer->height,
+		EGL_LINUX_DRM_FOURCC_EXT, buffer->format,
+		EGL_DMA_BUF_PLANE0_FD_EXT, object.i,
+		EGL_DMA_BUF_PLANE0_OFFSET_EXT, 0,
+		EGL_DMA_BUF_PLANE0_PITCH_EXT, buffer->pitch,
+		EGL_NONE,
+	};
+
+	entry->image = gles2.create_image(gles2.display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, NULL, attribs);
+	close(object.i);
+
+	return entry->image != EGL_NO_IMAGE_KHR;
+}
+
+static GLuint
+create_texture(void)
+{
+	GLuint texture;
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	return texture;
+}
+
+/**
+ * Uploads part of a mapped buffer to the currently bound texture.
+ */
+static void
+upload_box(struct wld_buffer *buffer, const pixman_box32_t *box)
+{
+	const char *data = (const char *)buffer->map + box->y1 * buffer->pitch + box->x1 * 4;
+	int32_t width = box->x2 - box->x1, y;
+
+	if (gles2.unpack_subimage) {
+		glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, buffer->pitch / 4);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, box->x1, box->y1, width, box->y2 - box->y1, GL_BGRA_EXT, GL_UNSIGNED_BYTE, data);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0);
+	} else {
+		/* Without a row length, rows have to be uploaded one at a time. */
+		for (y = box->y1; y < box->y2; ++y, data += buffer->pitch)
+			glTexSubImage2D(GL_TEXTURE_2D, 0, box->x1, y, width, 1, GL_BGRA_EXT, GL_UNSIGNED_BYTE, data);
+	}
+}
+
+/**
+ * Returns the texture of the buffer, creating it if necessary, or 0 if the
+ * buffer can't be read.
+ */
+static GLuint
+source_texture(struct wld_buffer *buffer)
+{
+	struct gles2_buffer *entry;
+	pixman_box32_t box = { 0, 0, buffer->width, buffer->height };
+
+	if (!supported_format(buffer->format) || !(entry = find_buffer(buffer, true)))
+		return 0;
+	if (entry->texture)
+		return entry->texture;
+
+	if (!buffer->map && import_image(entry)) {
+		entry->texture = create_texture();
+		gles2.image_target_texture(GL_TEXTURE_2D, entry->image);
+	} else if (wld_map(buffer)) {
+		entry->texture = create_texture();
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_BGRA_EXT, buffer->width, buffer->height, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, NULL);
+		upload_box(buffer, &box);
+		wld_unmap(buffer);
+	}
+
+	return entry->texture;
+}
+
+bool
+gles2_can_read(struct wld_buffer *buffer)
+{
+	/* Buffers in memory are uploaded when they are first painted, so that a
+	 * texture moved from the previous buffer can be used instead. */
+	if (buffer->map)
+		return supported_format(buffer->format);
+
+	return source_texture(buffer) != 0;
+}
+
+void
+gles2_flush_buffer(struct wld_buffer *buffer, pixman_region32_t *damage)
+{
+	struct gles2_buffer *entry;
+	pixman_region32_t region;
+	pixman_box32_t *boxes;
+	int i, num_boxes;
+
+	if (!(entry = find_buffer(buffer, false)) || !entry->texture || entry->image != EGL_NO_IMAGE_KHR)
+		return;
+	if (!wld_map(buffer))
+		return;
+
+	pixman_region32_init(&region);
+	pixman_region32_intersect_rect(&region, damage, 0, 0, buffer->width, buffer->height);
+	boxes = pixman_region32_rectangles(&region, &num_boxes);
+	glBindTexture(GL_TEXTURE_2D, entry->texture);
+	for (i = 0; i < num_boxes; ++i)
+		upload_box(buffer, &boxes[i]);
+	pixman_region32_fini(&region);
+	wld_unmap(buffer);
+}
+
+void
+gles2_move_texture(struct wld_buffer *from, struct wld_buffer *to)
+{
+	struct gles2_buffer *old, *new;
+
+	if (!from || !to || from == to || !to->map)
+		return;
+	if (from->width != to->width || from->height != to->height)
+		return;
+	if (!(old = find_buffer(from, false)) || !old->texture || old->image != EGL_NO_IMAGE_KHR || old->framebuffer)
+		return;
+	if ((new = find_buffer(to, false)) && new->texture)
+		return;
+	if (!new && !(new = find_buffer(to, true)))
+		return;
+
+	new->texture = old->texture;
+	old->texture = 0;
+}
+
+/**
+ * Returns the buffer's entry with a framebuffer to render into it, or NULL if
+ * the buffer can't be rendered into.
+ */
+static struct gles2_buffer *
+target_framebuffer(struct wld_buffer *buffer)
+{
+	struct gles2_buffer *entry;
+
+	if (!supported_format(buffer->format) || !(entry = find_buffer(buffer, true)))
+		return NULL;
+	if (entry->framebuffer)
+		return entry;
+
+	glGenFramebuffers(1, &entry->framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, entry->framebuffer);
+
+	if (import_image(entry)) {
+		glGenRenderbuffers(1, &entry->renderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, entry->renderbuffer);
+		gles2.image_target_renderbuffer(GL_RENDERBUFFER, entry->image);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, entry->renderbuffer);
+	} else if (wld_map(buffer)) {
+		/* Render into a texture, and read the damage back into memory. */
+		wld_unmap(buffer);
+		if (!entry->texture) {
+			entry->texture = create_texture();
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, buffer->width, buffer->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, entry->texture, 0);
+	}
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		WARNING("Could not create framebuffer for buffer\n");
+		destroy_objects(entry);
+		return NULL;
+	}
+
+	return entry;
+}
+
+static bool
+read_back(struct wld_buffer *buffer, pixman_region32_t *damage)
+{
+	pixman_box32_t *boxes;
+	int i, num_boxes;
+	int32_t width, height, y, x;
+	size_t size;
+	void *pixels;
+	uint8_t *src, *dst, tmp;
+
+	if (!wld_map(buffer))
+		return false;
+
+	pixman_region32_intersect_rect(damage, damage, 0, 0, buffer->width, buffer->height);
+	boxes = pixman_region32_rectangles(damage, &num_boxes);
+
+	for (i = 0; i < num_boxes; ++i) {
+		width = boxes[i].x2 - boxes[i].x1;
+		height = boxes[i].y2 - boxes[i].y1;
+		size = (size_t)width * height * 4;
+
+		if (size > gles2.pixels_size) {
+			if (!(pixels = realloc(gles2.pixels, size))) {
+				wld_unmap(buffer);
+				return false;
+			}
+			gles2.pixels = pixels;
+			gles2.pixels_size = size;
+		}
+
+		glReadPixels(boxes[i].x1, boxes[i].y1, width, height, gles2.read_bgra ? GL_BGRA_EXT : GL_RGBA, GL_UNSIGNED_BYTE, gles2.pixels);
+
+		src = gles2.pixels;
+		dst = (uint8_t *)buffer->map + boxes[i].y1 * buffer->pitch + boxes[i].x1 * 4;
+		for (y = 0; y < height; ++y, src += width * 4, dst += buffer->pitch) {
+			if (!gles2.read_bgra) {
+				for (x = 0; x < width; ++x) {
+					tmp = src[x * 4];
+					src[x * 4] = src[x * 4 + 2];
+					src[x * 4 + 2] = tmp;
+				}
+			}
+			memcpy(dst, src, width * 4);
+		}
+	}
+
+	wld_unmap(buffer);
+
+	return true;
+}
+
+bool
+gles2_paint(struct wld_buffer *target, struct wl_array *ops)
+{
+	static const GLfloat texcoords[] = { 0, 0, 1, 0, 0, 1, 1, 1 };
+	struct gles2_buffer *entry;
+	struct render_op *op;
+	pixman_region32_t damage;
+	pixman_box32_t *boxes;
+	GLfloat positions[8];
+	int i, num_boxes;
+	bool ret = true;
+
+	if (!(entry = target_framebuffer(target)))
+		return false;
+
+	/* Make sure all the buffers can be used before painting anything. */
+	wl_array_for_each (op, ops) {
+		if (op->buffer && !source_texture(op->buffer))
+			return false;
+	}
+
+	/* Rows of the buffers are in the same order as rows of the framebuffer,
+	 * so no coordinates need to be flipped. */
+	glBindFramebuffer(GL_FRAMEBUFFER, entry->framebuffer);
+	glViewport(0, 0, target->width, target->height);
+	glUseProgram(gles2.program);
+	glUniform2f(gles2.size, target->width, target->height);
+	glDisable(GL_BLEND);
+	glEnable(GL_SCISSOR_TEST);
+	glActiveTexture(GL_TEXTURE0);
+	glEnableVertexAttribArray(ATTRIB_POSITION);
+	glEnableVertexAttribArray(ATTRIB_TEXCOORD);
+	glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 0, texcoords);
+
+	pixman_region32_init(&damage);
+	wl_array_for_each (op, ops) {
+		pixman_region32_union(&damage, &damage, &op->region);
+
+		if (op->buffer) {
+			positions[0] = positions[4] = op->x;
+			positions[1] = positions[3] = op->y;
+			positions[2] = positions[6] = op->x + op->buffer->width;
+			positions[5] = positions[7] = op->y + op->buffer->height;
+			glBindTexture(GL_TEXTURE_2D, source_texture(op->buffer));
+			glVertexAttribPointer(ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 0, positions);
+		} else {
+			glClearColor((op->color >> 16 & 0xff) / 255.0f, (op->color >> 8 & 0xff) / 255.0f,
+			             (op->color & 0xff) / 255.0f, (op->color >> 24 & 0xff) / 255.0f);
+		}
+
+		/* Only the damaged rectangles are drawn. */
+		boxes = pixman_region32_rectangles(&op->region, &num_boxes);
+		for (i = 0; i < num_boxes; ++i) {
+			glScissor(boxes[i].x1, boxes[i].y1, boxes[i].x2 - boxes[i].x1, boxes[i].y2 - boxes[i].y1);
+			if (op->buffer)
+				glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+			else
+				glClear(GL_COLOR_BUFFER_BIT);
+		}
+	}
+
+	glDisableVertexAttribArray(ATTRIB_POSITION);
+	glDisableVertexAttribArray(ATTRIB_TEXCOORD);
+	glDisable(GL_SCISSOR_TEST);
+
+	/* Imported buffers may be displayed as soon as this returns. */
+	if (entry->image != EGL_NO_IMAGE_KHR)
+		glFinish();
+	else
+		ret = read_back(target, &damage);
+
+	pixman_region32_fini(&damage);
+
+	return ret;
+}
+
+bool
+gles2_initialize(void)
+{
+	static const EGLint config_attribs[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+		EGL_SURFACE_TYPE, 0,
+		EGL_NONE,
+	};
+	static const EGLint context_attribs[] = {
+		EGL_CONTEXT_CLIENT_VERSION, 2,
+		EGL_NONE,
+	};
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+	const char *extensions;
+	EGLConfig config;
+	EGLint num_configs;
+
+	extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	get_platform_display = (void *)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+	if (!has_extension(extensions, "EGL_MESA_platform_surfaceless") || !get_platform_display) {
+		ERROR("EGL does not support surfaceless displays\n");
+		goto error0;
+	}
+
+	gles2.display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+
+	if (gles2.display == EGL_NO_DISPLAY || !eglInitialize(gles2.display, NULL, NULL)) {
+		ERROR("Could not initialize EGL display\n");
+		goto error0;
+	}
+
+	extensions = eglQueryString(gles2.display, EGL_EXTENSIONS);
+
+	if (!has_extension(extensions, "EGL_KHR_surfaceless_context")) {
+		ERROR("EGL does not support surfaceless contexts\n");
+		goto error1;
+	}
+
+	gles2.dmabuf_import = has_extension(extensions, "EGL_KHR_image_base") && has_extension(extensions, "EGL_EXT_image_dma_buf_import");
+
+	if (!eglBindAPI(EGL_OPENGL_ES_API) || !eglChooseConfig(gles2.display, config_attribs, &config, 1, &num_configs) || num_configs < 1) {
+		ERROR("Could not find EGL config\n");
+		goto error1;
+	}
+
+	if (!(gles2.context = eglCreateContext(gles2.display, config, EGL_NO_CONTEXT, context_attribs))) {
+		ERROR("Could not create EGL context\n");
+		goto error1;
+	}
+
+	if (!eglMakeCurrent(gles2.display, EGL_NO_SURFACE, EGL_NO_SURFACE, gles2.context)) {
+		ERROR("Could not make EGL context current\n");
+		goto error2;
+	}
+
+	extensions = (const char *)glGetString(GL_EXTENSIONS);
+
+	if (!has_extension(extensions, "GL_EXT_texture_format_BGRA8888")) {
+		ERROR("GLES2 does not support BGRA textures\n");
+		goto error3;
+	}
+
+	gles2.read_bgra = has_extension(extensions, "GL_EXT_read_format_bgra");
+	gles2.unpack_subimage = has_extension(extensions, "GL_EXT_unpack_subimage");
+
+	if (gles2.dmabuf_import) {
+		gles2.create_image = (void *)eglGetProcAddress("eglCreateImageKHR");
+		gles2.destroy_image = (void *)eglGetProcAddress("eglDestroyImageKHR");
+		gles2.image_target_texture = (void *)eglGetProcAddress("glEGLImageTargetTexture2DOES");
+		gles2.image_target_renderbuffer = (void *)eglGetProcAddress("glEGLImageTargetRenderbufferStorageOES");
+		gles2.dmabuf_import = has_extension(extensions, "GL_OES_EGL_image")
+		                   && gles2.create_image && gles2.destroy_image
+		                   && gles2.image_target_texture && gles2.image_target_renderbuffer;
+	}
+
+	if (!create_program())
+		goto error3;
+
+	wl_list_init(&gles2.buffers);
+	gles2.pixels = NULL;
+	gles2.pixels_size = 0;
+
+	DEBUG("Using GLES2 renderer %s%s\n", glGetString(GL_RENDERER), gles2.dmabuf_import ? " with DMA-BUF import" : "");
+
+	return true;
+
+error3:
+	eglMakeCurrent(gles2.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+error2:
+	eglDestroyContext(gles2.display, gles2.context);
+error1:
+	eglTerminate(gles2.display);
+error0:
+	gles2.display = EGL_NO_DISPLAY;
+	return false;
+}
+
+void
+gles2_finalize(void)
+{
+	struct gles2_buffer *entry, *next;
+
+	/* The buffers may be destroyed later, so only their objects are
+	 * destroyed here. */
+	wl_list_for_each_safe (entry, next, &gles2.buffers, link) {
+		destroy_objects(entry);
+		wl_list_remove(&entry->link);
+		wl_list_init(&entry->link);
+	}
+
+	glDeleteProgram(gles2.program);
+	free(gles2.pixels);
+	eglMakeCurrent(gles2.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(gles2.display, gles2.context);
+	eglTerminate(gles2.display);
+	gles2.display = EGL_NO_DISPLAY;
+}
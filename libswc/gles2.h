@@ -0,0 +1,71 @@
+/* swc: libswc/gles2.h
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SWC_GLES2_H
+#define SWC_GLES2_H
+
+#include <stdbool.h>
+#include <pixman.h>
+
+#define SWC_GLES2_ENV "SWC_GLES2"
+
+struct wl_array;
+struct wld_buffer;
+
+/**
+ * The GLES2 renderer composites with OpenGL ES 2 on a surfaceless EGL display,
+ * so it works with Mesa's llvmpipe driver as well as with GPUs. It performs
+ * the same render operations (struct render_op) as the render pool.
+ *
+ * Buffers in memory are uploaded to textures, and DRM buffers are imported
+ * as DMA-BUFs through EGL images. Targets that can be imported are rendered
+ * into directly, and the damage of other targets is read back into memory.
+ */
+bool gles2_initialize(void);
+void gles2_finalize(void);
+
+/**
+ * Returns whether the renderer can read the contents of the buffer.
+ */
+bool gles2_can_read(struct wld_buffer *buffer);
+
+/**
+ * Updates the texture of a buffer in memory with the damaged region of the
+ * buffer, in buffer coordinates.
+ */
+void gles2_flush_buffer(struct wld_buffer *buffer, pixman_region32_t *damage);
+
+/**
+ * Moves the texture of a buffer to another buffer of the same size that
+ * replaces it, so that only the damage of the new buffer needs to be
+ * uploaded.
+ */
+void gles2_move_texture(struct wld_buffer *from, struct wld_buffer *to);
+
+/**
+ * Performs the render operations in order. Returns false without painting
+ * anything if the target or any of the buffers could not be used.
+ */
+bool gles2_paint(struct wld_buffer *target, struct wl_array *ops);
+
+#endif
@@ -0,0 +1,171 @@
+/* swc: libswc/grid.c
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "grid.h"
+#include "util.h"
+
+#include <stdlib.h>
+
+static void
+cell_range(struct grid *grid, const pixman_box32_t *box, pixman_box32_t *range)
+{
+	int32_t x1 = MAX(box->x1, grid->extents.x1), y1 = MAX(box->y1, grid->extents.y1),
+	        x2 = MIN(box->x2, grid->extents.x2), y2 = MIN(box->y2, grid->extents.y2);
+
+	if (x1 >= x2 || y1 >= y2) {
+		*range = (pixman_box32_t){ 0 };
+		return;
+	}
+
+	range->x1 = (x1 - grid->extents.x1) / grid->cell_size;
+	range->y1 = (y1 - grid->extents.y1) / grid->cell_size;
+	range->x2 = (x2 - grid->extents.x1 - 1) / grid->cell_size + 1;
+	range->y2 = (y2 - grid->extents.y1 - 1) / grid->cell_size + 1;
+}
+
+static inline bool
+range_equal(const pixman_box32_t *r1, const pixman_box32_t *r2)
+{
+	return r1->x1 == r2->x1 && r1->y1 == r2->y1 && r1->x2 == r2->x2 && r1->y2 == r2->y2;
+}
+
+bool
+grid_initialize(struct grid *grid, const pixman_box32_t *extents, uint32_t cell_size)
+{
+	uint32_t index;
+
+	grid->extents = *extents;
+	grid->cell_size = cell_size;
+	grid->width = (MAX(extents->x2 - extents->x1, 1) + cell_size - 1) / cell_size;
+	grid->height = (MAX(extents->y2 - extents->y1, 1) + cell_size - 1) / cell_size;
+	grid->serial = 0;
+
+	if (!(grid->cells = malloc(grid->width * grid->height * sizeof(grid->cells[0]))))
+		return false;
+
+	for (index = 0; index < grid->width * grid->height; ++index)
+		wl_array_init(&grid->cells[index]);
+
+	return true;
+}
+
+void
+grid_finalize(struct grid *grid)
+{
+	uint32_t index;
+
+	for (index = 0; index < grid->width * grid->height; ++index)
+		wl_array_release(&grid->cells[index]);
+	free(grid->cells);
+}
+
+void
+grid_entry_initialize(struct grid_entry *entry)
+{
+	entry->cells = (pixman_box32_t){ 0 };
+	entry->serial = 0;
+}
+
+void
+grid_remove(struct grid *grid, struct grid_entry *entry)
+{
+	struct grid_entry **item;
+	int32_t x, y;
+
+	for (y = entry->cells.y1; y < entry->cells.y2; ++y) {
+		for (x = entry->cells.x1; x < entry->cells.x2; ++x) {
+			struct wl_array *cell = &grid->cells[y * grid->width + x];
+
+			wl_array_for_each (item, cell) {
+				if (*item == entry) {
+					array_remove(cell, item, sizeof(*item));
+					break;
+				}
+			}
+		}
+	}
+
+	entry->cells = (pixman_box32_t){ 0 };
+}
+
+void
+grid_update(struct grid *grid, struct grid_entry *entry, const pixman_box32_t *box)
+{
+	struct grid_entry **item;
+	pixman_box32_t cells;
+	int32_t x, y;
+
+	cell_range(grid, box, &cells);
+
+	if (range_equal(&cells, &entry->cells))
+		return;
+
+	grid_remove(grid, entry);
+
+	for (y = cells.y1; y < cells.y2; ++y) {
+		for (x = cells.x1; x < cells.x2; ++x) {
+			if ((item = wl_array_add(&grid->cells[y * grid->width + x], sizeof(*item))))
+				*item = entry;
+		}
+	}
+
+	entry->cells = cells;
+}
+
+struct wl_array *
+grid_cell(struct grid *grid, int32_t x, int32_t y)
+{
+	if (x < grid->extents.x1 || x >= grid->extents.x2 || y < grid->extents.y1 || y >= grid->extents.y2)
+		return NULL;
+
+	x = (x - grid->extents.x1) / grid->cell_size;
+	y = (y - grid->extents.y1) / grid->cell_size;
+
+	return &grid->cells[y * grid->width + x];
+}
+
+bool
+grid_query(struct grid *grid, const pixman_box32_t *box, struct wl_array *entries)
+{
+	struct grid_entry **item, **result;
+	pixman_box32_t cells;
+	int32_t x, y;
+
+	cell_range(grid, box, &cells);
+	++grid->serial;
+
+	for (y = cells.y1; y < cells.y2; ++y) {
+		for (x = cells.x1; x < cells.x2; ++x) {
+			wl_array_for_each (item, &grid->cells[y * grid->width + x]) {
+				if ((*item)->serial == grid->serial)
+					continue;
+				if (!(result = wl_array_add(entries, sizeof(*result))))
+					return false;
+				*result = *item;
+				(*item)->serial = grid->serial;
+			}
+		}
+	}
+
+	return true;
+}
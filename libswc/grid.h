@@ -0,0 +1,74 @@
+/* swc: libswc/grid.h
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SWC_GRID_H
+#define SWC_GRID_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pixman.h>
+#include <wayland-util.h>
+
+/**
+ * A grid is a spatial index that divides an area into square cells, each
+ * containing the entries whose boxes overlap it. This allows us to find the
+ * entries near a point or box without looking at every entry.
+ */
+struct grid {
+	pixman_box32_t extents;
+	uint32_t cell_size, width, height;
+	struct wl_array *cells;
+	uint32_t serial;
+};
+
+struct grid_entry {
+	/* The range of cells the entry is in, or an empty box if it is not in the
+	 * grid. */
+	pixman_box32_t cells;
+	uint32_t serial;
+};
+
+bool grid_initialize(struct grid *grid, const pixman_box32_t *extents, uint32_t cell_size);
+void grid_finalize(struct grid *grid);
+
+void grid_entry_initialize(struct grid_entry *entry);
+
+/**
+ * Update the position of an entry in the grid to cover the specified box.
+ */
+void grid_update(struct grid *grid, struct grid_entry *entry, const pixman_box32_t *box);
+void grid_remove(struct grid *grid, struct grid_entry *entry);
+
+/**
+ * Returns the array of entries (of type struct grid_entry *) in the cell
+ * containing the specified point, or NULL if the point lies outside the grid.
+ */
+struct wl_array *grid_cell(struct grid *grid, int32_t x, int32_t y);
+
+/**
+ * Adds every entry overlapping the cells covering the specified box to
+ * entries, each at most once.
+ */
+bool grid_query(struct grid *grid, const pixman_box32_t *box, struct wl_array *entries);
+
+#endif
@@ -0,0 +1,178 @@
+/* swc: libswc/headless.c
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "headless.h"
+#include "drm.h"
+#include "internal.h"
+#include "output.h"
+#include "screen.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <wld/wld.h>
+#include <wld/pixman.h>
+#include <xf86drmMode.h>
+
+struct screen_config {
+	uint32_t width, height, refresh;
+};
+
+static struct {
+	struct wl_array configs;
+} headless;
+
+static bool
+add_configs(const char *string, char **end)
+{
+	struct screen_config config, *configs;
+	unsigned long count = 1;
+	uint32_t i;
+
+	config.width = strtoul(string, end, 10);
+	if (**end == '*') {
+		count = config.width;
+		config.width = strtoul(*end + 1, end, 10);
+	}
+	if (**end != 'x')
+		return false;
+	config.height = strtoul(*end + 1, end, 10);
+	config.refresh = 60;
+	if (**end == '@')
+		config.refresh = strtoul(*end + 1, end, 10);
+
+	if (count == 0 || config.width == 0 || config.height == 0 || config.refresh == 0)
+		return false;
+
+	if (!(configs = wl_array_add(&headless.configs, count * sizeof(config))))
+		return false;
+	for (i = 0; i < count; ++i)
+		configs[i] = config;
+
+	return true;
+}
+
+static bool
+parse_configs(const char *string)
+{
+	char *end;
+
+	if (*string == '\0')
+		string = "1920x1080@60";
+
+	for (;;) {
+		if (!add_configs(string, &end) || (*end != ',' && *end != '\0')) {
+			ERROR("Invalid headless screen specification '%s'\n", string);
+			return false;
+		}
+		if (*end == '\0')
+			break;
+		string = end + 1;
+	}
+
+	return true;
+}
+
+bool
+headless_initialize(void)
+{
+	const char *string;
+
+	wl_array_init(&headless.configs);
+
+	if (!(string = getenv(SWC_HEADLESS_ENV)) || !parse_configs(string))
+		goto error0;
+
+	swc.drm->fd = -1;
+	swc.drm->cursor_w = 64;
+	swc.drm->cursor_h = 64;
+	swc.drm->async_page_flip = true;
+
+	if (!(swc.drm->context = wld_pixman_create_context())) {
+		ERROR("Could not create WLD pixman context\n");
+		goto error0;
+	}
+
+	if (!(swc.drm->renderer = wld_create_renderer(swc.drm->context))) {
+		ERROR("Could not create WLD pixman renderer\n");
+		goto error1;
+	}
+
+	return true;
+
+error1:
+	wld_destroy_context(swc.drm->context);
+error0:
+	wl_array_release(&headless.configs);
+	return false;
+}
+
+void
+headless_finalize(void)
+{
+	wld_destroy_renderer(swc.drm->renderer);
+	wld_destroy_context(swc.drm->context);
+	wl_array_release(&headless.configs);
+}
+
+bool
+headless_create_screens(struct wl_list *screens)
+{
+	struct screen_config *config;
+	struct output *output;
+	struct screen *screen;
+	drmModeModeInfo mode_info;
+	drmModeConnector connector;
+	uint32_t id = 0;
+
+	wl_array_for_each (config, &headless.configs) {
+		mode_info = (drmModeModeInfo){
+			.hdisplay = config->width,
+			.vdisplay = config->height,
+			.vrefresh = config->refresh,
+			.type = DRM_MODE_TYPE_DRIVER | DRM_MODE_TYPE_PREFERRED,
+		};
+		snprintf(mode_info.name, sizeof(mode_info.name), "%ux%u", config->width, config->height);
+
+		connector = (drmModeConnector){
+			.connector_id = id,
+			.connection = DRM_MODE_CONNECTED,
+			.count_modes = 1,
+			.modes = &mode_info,
+		};
+
+		if (!(output = output_new(&connector)))
+			continue;
+
+		if (!(screen = screen_new(0, output))) {
+			output_destroy(output);
+			continue;
+		}
+
+		output->screen = screen;
+		screen->id = id++;
+		wl_list_insert(screens, &screen->link);
+	}
+
+	return true;
+}
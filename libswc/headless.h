@@ -0,0 +1,45 @@
+/* swc: libswc/headless.h
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SWC_HEADLESS_H
+#define SWC_HEADLESS_H
+
+#include <stdbool.h>
+
+#define SWC_HEADLESS_ENV "SWC_HEADLESS"
+
+struct wl_list;
+
+/**
+ * The headless backend replaces DRM with a pixman context and a set of
+ * virtual screens, described by the SWC_HEADLESS environment variable as a
+ * comma-separated list of [COUNT*]WIDTHxHEIGHT[@REFRESH] entries (for
+ * example "2*1920x1080@60,1280x720@144"). An empty value creates a single
+ * 1920x1080 screen at 60 Hz.
+ */
+bool headless_initialize(void);
+void headless_finalize(void);
+
+bool headless_create_screens(struct wl_list *screens);
+
+#endif
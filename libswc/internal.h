@@ -39,6 +39,9 @@ struct swc {
 	struct wl_signal event_signal;
 	bool active;
 
+	/* Whether we are running without a DRM device or swc-launch. */
+	bool headless;
+
 	const struct swc_seat *const seat;
 	const struct swc_bindings *const bindings;
 	struct wl_list screens;
@@ -26,20 +26,28 @@ SWC_SOURCES =                       \
     libswc/compositor.c             \
     libswc/cursor_plane.c           \
     libswc/data.c                   \
+    libswc/damage.c                 \
     libswc/data_device.c            \
     libswc/data_device_manager.c    \
     libswc/drm.c                    \
+    libswc/grid.c                   \
+    libswc/headless.c               \
     libswc/input.c                  \
     libswc/keyboard.c               \
     libswc/launch.c                 \
     libswc/mode.c                   \
     libswc/output.c                 \
+    libswc/output_power.c           \
     libswc/panel.c                  \
     libswc/panel_manager.c          \
     libswc/pointer.c                \
+    libswc/presentation.c           \
     libswc/primary_plane.c          \
     libswc/region.c                 \
+    libswc/render_pool.c            \
+    libswc/render_thread.c          \
     libswc/screen.c                 \
+    libswc/screen_set.c             \
     libswc/seat.c                   \
     libswc/shell.c                  \
     libswc/shell_surface.c          \
@@ -48,13 +56,17 @@ SWC_SOURCES =                       \
     libswc/subsurface.c             \
     libswc/surface.c                \
     libswc/swc.c                    \
+    libswc/tearing_control.c        \
     libswc/util.c                   \
     libswc/view.c                   \
     libswc/wayland_buffer.c         \
     libswc/window.c                 \
     libswc/xdg_shell.c              \
+    protocol/presentation-time-protocol.c \
     protocol/swc-protocol.c         \
+    protocol/tearing-control-v1-protocol.c \
     protocol/wayland-drm-protocol.c \
+    protocol/wlr-output-power-management-unstable-v1-protocol.c \
     protocol/xdg-shell-protocol.c
 
 ifeq ($(ENABLE_LIBUDEV),1)
@@ -62,6 +74,12 @@ $(dir)_CFLAGS += -DENABLE_LIBUDEV
 $(dir)_PACKAGES += libudev
 endif
 
+ifeq ($(ENABLE_GLES2),1)
+$(dir)_CFLAGS += -DENABLE_GLES2
+$(dir)_PACKAGES += egl glesv2
+SWC_SOURCES += libswc/gles2.c
+endif
+
 SWC_STATIC_OBJECTS = $(SWC_SOURCES:%.c=%.o)
 SWC_SHARED_OBJECTS = $(SWC_SOURCES:%.c=%.lo)
 
@@ -70,6 +88,9 @@ objects = $(foreach obj,$(1),$(dir)/$(obj).o $(dir)/$(obj).lo)
 $(call objects,compositor panel_manager panel screen): protocol/swc-server-protocol.h
 $(call objects,drm drm_buffer): protocol/wayland-drm-server-protocol.h
 $(call objects,xdg_shell): protocol/xdg-shell-server-protocol.h
+$(call objects,compositor presentation): protocol/presentation-time-server-protocol.h
+$(call objects,tearing_control): protocol/tearing-control-v1-server-protocol.h
+$(call objects,output_power): protocol/wlr-output-power-management-unstable-v1-server-protocol.h
 $(call objects,pointer): cursor/cursor_data.h
 
 $(dir)/libswc-internal.o: $(SWC_STATIC_OBJECTS)
@@ -82,7 +103,7 @@ $(dir)/libswc.a: $(dir)/libswc.o
 	$(Q_AR)$(AR) cru $@ $^
 
 $(dir)/$(LIBSWC_LIB): $(SWC_SHARED_OBJECTS)
-	$(link) -shared -Wl,-soname,$(LIBSWC_SO) -Wl,-no-undefined $(libswc_PACKAGE_LIBS)
+	$(link) -shared -Wl,-soname,$(LIBSWC_SO) -Wl,-no-undefined $(libswc_PACKAGE_LIBS) -lpthread
 
 $(dir)/$(LIBSWC_SO): $(dir)/$(LIBSWC_LIB)
 	$(Q_SYM)ln -sf $(notdir $<) $@
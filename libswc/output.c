@@ -2,6 +2,7 @@
 #include "drm.h"
 #include "internal.h"
 #include "mode.h"
+#include "output_power.h"
 #include "screen.h"
 #include "util.h"
 
@@ -11,6 +12,16 @@
 #include <drm.h>
 #include <xf86drm.h>
 
+static void
+send_geometry(struct wl_resource *resource, struct output *output)
+{
+	struct screen *screen = output->screen;
+
+	wl_output_send_geometry(resource, screen->base.geometry.x, screen->base.geometry.y,
+	                        output->physical_width, output->physical_height,
+	                        0, "unknown", "unknown", WL_OUTPUT_TRANSFORM_NORMAL);
+}
+
 static void
 bind_output(struct wl_client *client, void *data, uint32_t version, uint32_t id)
 {
@@ -33,9 +44,7 @@ bind_output(struct wl_client *client, void *data, uint32_t version, uint32_t id)
 	wl_resource_set_implementation(resource, NULL, output, &remove_resource);
 	wl_list_insert(&output->resources, wl_resource_get_link(resource));
 
-	wl_output_send_geometry(resource, screen->base.geometry.x, screen->base.geometry.y,
-	                        output->physical_width, output->physical_height,
-	                        0, "unknown", "unknown", WL_OUTPUT_TRANSFORM_NORMAL);
+	send_geometry(resource, output);
 
 	wl_array_for_each (mode, &output->modes) {
 		flags = 0;
@@ -51,6 +60,35 @@ bind_output(struct wl_client *client, void *data, uint32_t version, uint32_t id)
 		wl_output_send_done(resource);
 }
 
+void
+output_send_mode(struct output *output)
+{
+	struct mode *mode = &output->screen->planes.primary.mode;
+	struct wl_resource *resource;
+	uint32_t flags = WL_OUTPUT_MODE_CURRENT;
+
+	if (mode->preferred)
+		flags |= WL_OUTPUT_MODE_PREFERRED;
+
+	wl_resource_for_each (resource, &output->resources) {
+		wl_output_send_mode(resource, flags, mode->width, mode->height, mode->refresh);
+		if (wl_resource_get_version(resource) >= 2)
+			wl_output_send_done(resource);
+	}
+}
+
+void
+output_send_geometry(struct output *output)
+{
+	struct wl_resource *resource;
+
+	wl_resource_for_each (resource, &output->resources) {
+		send_geometry(resource, output);
+		if (wl_resource_get_version(resource) >= 2)
+			wl_output_send_done(resource);
+	}
+}
+
 struct output *
 output_new(drmModeConnectorPtr connector)
 {
@@ -75,6 +113,7 @@ output_new(drmModeConnectorPtr connector)
 	output->preferred_mode = NULL;
 
 	wl_list_init(&output->resources);
+	wl_list_init(&output->power_resources);
 	wl_array_init(&output->modes);
 	pixman_region32_init(&output->current_damage);
 	pixman_region32_init(&output->previous_damage);
@@ -111,6 +150,7 @@ error0:
 void
 output_destroy(struct output *output)
 {
+	output_power_remove_output(output);
 	wl_array_release(&output->modes);
 	wl_global_destroy(output->global);
 	free(output);
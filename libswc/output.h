@@ -24,10 +24,23 @@ struct output {
 
 	struct wl_global *global;
 	struct wl_list resources;
+	/* The power controls of the output (zwlr_output_power_v1). */
+	struct wl_list power_resources;
 	struct wl_list link;
 };
 
 struct output *output_new(drmModeConnector *connector);
 void output_destroy(struct output *output);
 
+/**
+ * Sends the current mode of the output's screen to the clients after it has
+ * changed.
+ */
+void output_send_mode(struct output *output);
+
+/**
+ * Sends the position of the output's screen to the clients after it has moved.
+ */
+void output_send_geometry(struct output *output);
+
 #endif
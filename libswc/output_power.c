@@ -0,0 +1,158 @@
+/* swc: libswc/output_power.c
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "output_power.h"
+#include "internal.h"
+#include "output.h"
+#include "screen.h"
+#include "util.h"
+
+#include <wayland-server.h>
+#include "wlr-output-power-management-unstable-v1-server-protocol.h"
+
+static struct {
+	struct wl_global *global;
+} output_power;
+
+static void
+destroy(struct wl_client *client, struct wl_resource *resource)
+{
+	wl_resource_destroy(resource);
+}
+
+static void
+send_mode(struct wl_resource *resource, struct output *output)
+{
+	zwlr_output_power_v1_send_mode(resource, output->screen->planes.primary.off ? ZWLR_OUTPUT_POWER_V1_MODE_OFF : ZWLR_OUTPUT_POWER_V1_MODE_ON);
+}
+
+/**
+ * Tells the client that the power control no longer works, and detaches it
+ * from its output.
+ */
+static void
+fail(struct wl_resource *resource)
+{
+	zwlr_output_power_v1_send_failed(resource);
+	wl_resource_set_user_data(resource, NULL);
+	wl_list_remove(wl_resource_get_link(resource));
+	wl_list_init(wl_resource_get_link(resource));
+}
+
+static void
+set_mode(struct wl_client *client, struct wl_resource *resource, uint32_t mode)
+{
+	struct output *output = wl_resource_get_user_data(resource);
+
+	if (mode != ZWLR_OUTPUT_POWER_V1_MODE_OFF && mode != ZWLR_OUTPUT_POWER_V1_MODE_ON) {
+		wl_resource_post_error(resource, ZWLR_OUTPUT_POWER_V1_ERROR_INVALID_MODE, "invalid power mode %u", mode);
+		return;
+	}
+
+	if (!output)
+		return;
+
+	if (!screen_set_power(output->screen, mode == ZWLR_OUTPUT_POWER_V1_MODE_ON))
+		fail(resource);
+}
+
+static const struct zwlr_output_power_v1_interface output_power_implementation = {
+	.set_mode = set_mode,
+	.destroy = destroy,
+};
+
+static void
+get_output_power(struct wl_client *client, struct wl_resource *resource, uint32_t id, struct wl_resource *output_resource)
+{
+	struct output *output = wl_resource_get_user_data(output_resource);
+	struct wl_resource *power_resource;
+
+	power_resource = wl_resource_create(client, &zwlr_output_power_v1_interface, wl_resource_get_version(resource), id);
+
+	if (!power_resource) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	wl_resource_set_implementation(power_resource, &output_power_implementation, output, &remove_resource);
+	wl_list_insert(&output->power_resources, wl_resource_get_link(power_resource));
+	send_mode(power_resource, output);
+}
+
+static const struct zwlr_output_power_manager_v1_interface manager_implementation = {
+	.get_output_power = get_output_power,
+	.destroy = destroy,
+};
+
+static void
+bind_manager(struct wl_client *client, void *data, uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource;
+
+	if (version > 1)
+		version = 1;
+
+	resource = wl_resource_create(client, &zwlr_output_power_manager_v1_interface, version, id);
+
+	if (!resource) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	wl_resource_set_implementation(resource, &manager_implementation, NULL, NULL);
+}
+
+bool
+output_power_initialize(void)
+{
+	output_power.global = wl_global_create(swc.display, &zwlr_output_power_manager_v1_interface, 1, NULL, &bind_manager);
+
+	if (!output_power.global)
+		return false;
+
+	return true;
+}
+
+void
+output_power_finalize(void)
+{
+	wl_global_destroy(output_power.global);
+}
+
+void
+output_power_send_mode(struct output *output)
+{
+	struct wl_resource *resource;
+
+	wl_resource_for_each (resource, &output->power_resources)
+		send_mode(resource, output);
+}
+
+void
+output_power_remove_output(struct output *output)
+{
+	struct wl_resource *resource, *tmp;
+
+	wl_resource_for_each_safe (resource, tmp, &output->power_resources)
+		fail(resource);
+}
@@ -0,0 +1,48 @@
+/* swc: libswc/output_power.h
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SWC_OUTPUT_POWER_H
+#define SWC_OUTPUT_POWER_H
+
+#include <stdbool.h>
+
+struct output;
+
+/**
+ * The wlr-output-power-management protocol lets clients turn screens off and
+ * back on.
+ */
+bool output_power_initialize(void);
+void output_power_finalize(void);
+
+/**
+ * Sends the power mode of the output's screen to the clients controlling it.
+ */
+void output_power_send_mode(struct output *output);
+
+/**
+ * Invalidates the power controls of an output that is being destroyed.
+ */
+void output_power_remove_output(struct output *output);
+
+#endif
@@ -0,0 +1,132 @@
+/* swc: libswc/presentation.c
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "presentation.h"
+#include "internal.h"
+#include "output.h"
+#include "screen.h"
+#include "surface.h"
+#include "util.h"
+
+#include <time.h>
+#include <wayland-server.h>
+#include "presentation-time-server-protocol.h"
+
+static struct {
+	struct wl_global *global;
+} presentation;
+
+static void
+destroy(struct wl_client *client, struct wl_resource *resource)
+{
+	wl_resource_destroy(resource);
+}
+
+static void
+feedback(struct wl_client *client, struct wl_resource *resource, struct wl_resource *surface_resource, uint32_t id)
+{
+	struct surface *surface = wl_resource_get_user_data(surface_resource);
+	struct wl_resource *feedback_resource;
+
+	feedback_resource = wl_resource_create(client, &wp_presentation_feedback_interface, 1, id);
+
+	if (!feedback_resource) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	wl_resource_set_implementation(feedback_resource, NULL, NULL, &remove_resource);
+	wl_list_insert(surface->pending.state.feedbacks.prev, wl_resource_get_link(feedback_resource));
+}
+
+static const struct wp_presentation_interface presentation_implementation = {
+	.destroy = destroy,
+	.feedback = feedback,
+};
+
+static void
+bind_presentation(struct wl_client *client, void *data, uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource;
+
+	if (version > 1)
+		version = 1;
+
+	resource = wl_resource_create(client, &wp_presentation_interface, version, id);
+
+	if (!resource) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	wl_resource_set_implementation(resource, &presentation_implementation, NULL, NULL);
+	wp_presentation_send_clock_id(resource, CLOCK_MONOTONIC);
+}
+
+bool
+presentation_initialize(void)
+{
+	presentation.global = wl_global_create(swc.display, &wp_presentation_interface, 1, NULL, &bind_presentation);
+
+	if (!presentation.global)
+		return false;
+
+	return true;
+}
+
+void
+presentation_finalize(void)
+{
+	wl_global_destroy(presentation.global);
+}
+
+void
+presentation_present(struct wl_list *feedbacks, struct screen *screen, uint64_t time, uint32_t refresh, uint64_t sequence, uint32_t flags)
+{
+	struct wl_resource *resource, *tmp, *output_resource;
+	struct output *output;
+	uint64_t sec = time / 1000000000;
+
+	wl_resource_for_each_safe (resource, tmp, feedbacks) {
+		wl_list_for_each (output, &screen->outputs, link) {
+			output_resource = wl_resource_find_for_client(&output->resources, wl_resource_get_client(resource));
+			if (output_resource)
+				wp_presentation_feedback_send_sync_output(resource, output_resource);
+		}
+
+		wp_presentation_feedback_send_presented(resource, sec >> 32, sec & 0xffffffff, time % 1000000000, refresh,
+		                                        sequence >> 32, sequence & 0xffffffff, flags);
+		wl_resource_destroy(resource);
+	}
+}
+
+void
+presentation_discard(struct wl_list *feedbacks)
+{
+	struct wl_resource *resource, *tmp;
+
+	wl_resource_for_each_safe (resource, tmp, feedbacks) {
+		wp_presentation_feedback_send_discarded(resource);
+		wl_resource_destroy(resource);
+	}
+}
@@ -0,0 +1,49 @@
+/* swc: libswc/presentation.h
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SWC_PRESENTATION_H
+#define SWC_PRESENTATION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct screen;
+struct wl_list;
+
+bool presentation_initialize(void);
+void presentation_finalize(void);
+
+/**
+ * Sends the presented event for each feedback in the list, and destroys them.
+ * The time is in nanoseconds on the monotonic clock, refresh is the duration
+ * of a refresh period in nanoseconds (or 0 if unknown), and flags is a
+ * combination of wp_presentation_feedback_kind.
+ */
+void presentation_present(struct wl_list *feedbacks, struct screen *screen, uint64_t time, uint32_t refresh, uint64_t sequence, uint32_t flags);
+
+/**
+ * Sends the discarded event for each feedback in the list, and destroys them.
+ */
+void presentation_discard(struct wl_list *feedbacks);
+
+#endif
@@ -29,110 +29,555 @@
 #include "util.h"
 
 #include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <sys/timerfd.h>
 #include <wld/wld.h>
 #include <wld/drm.h>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 
-enum {
-	WLD_USER_OBJECT_FRAMEBUFFER = WLD_USER_ID
-};
+static bool
+update(struct view *view)
+{
+	return true;
+}
 
-struct framebuffer {
-	struct wld_exporter exporter;
-	struct wld_destructor destructor;
-	uint32_t id;
-};
+static void
+finish_frame(struct primary_plane *plane, uint64_t time)
+{
+	plane->last_vblank = time;
+	view_frame(&plane->view, time / 1000000);
+}
+
+/**
+ * Updates the vertical blank counter from the low 32 bits reported by DRM.
+ */
+static void
+set_sequence(struct primary_plane *plane, uint32_t sequence)
+{
+	uint64_t msc = (plane->msc & ~0xffffffffull) | sequence;
+
+	if (msc < plane->msc)
+		msc += 1ull << 32;
+	plane->msc = msc;
+	plane->hardware_clock = true;
+}
+
+static void
+send_frame(void *data)
+{
+	struct primary_plane *plane = data;
+
+	++plane->msc;
+	plane->hardware_clock = false;
+	finish_frame(plane, get_monotonic_time());
+}
+
+static int
+handle_vblank_timer(int fd, uint32_t mask, void *data)
+{
+	struct primary_plane *plane = data;
+	uint64_t expirations, time;
+
+	if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return 0;
+
+	/* The emulated vertical blanks started when the monotonic clock did. */
+	time = get_monotonic_time();
+	/* The counter must not go back after switching to a slower mode. */
+	plane->msc = MAX(time / (1000000000000ull / plane->mode.refresh), plane->msc + 1);
+	plane->hardware_clock = false;
+	finish_frame(plane, time);
+	return 0;
+}
+
+/**
+ * Arms the vblank timer of a headless screen so that it fires at the start of
+ * the next refresh period, as if the screen had been scanning out since the
+ * monotonic clock started.
+ */
+static int
+schedule_vblank(struct primary_plane *plane)
+{
+	struct itimerspec timer = { 0 };
+	struct timespec now;
+	uint64_t interval, next;
+
+	interval = 1000000000000ull / plane->mode.refresh;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	next = ((now.tv_sec * 1000000000ull + now.tv_nsec) / interval + 1) * interval;
+	timer.it_value.tv_sec = next / 1000000000;
+	timer.it_value.tv_nsec = next % 1000000000;
+
+	if (timerfd_settime(plane->vblank_fd, TFD_TIMER_ABSTIME, &timer, NULL) < 0) {
+		ERROR("Could not arm vblank timer: %s\n", strerror(errno));
+		return -errno;
+	}
+
+	return 0;
+}
+
+/* The maximum number of overlay planes claimed for each CRTC. */
+#define MAX_OVERLAYS 3
 
 static bool
-framebuffer_export(struct wld_exporter *exporter, struct wld_buffer *buffer, uint32_t type, union wld_object *object)
+add_planes(struct primary_plane *plane, drmModeAtomicReq *req)
 {
-	struct framebuffer *framebuffer = wl_container_of(exporter, framebuffer, exporter);
+	struct overlay_plane *overlay;
+	struct mirror *mirror;
+	bool ok;
 
-	switch (type) {
-	case WLD_USER_OBJECT_FRAMEBUFFER:
-		object->u32 = framebuffer->id;
-		break;
-	default:
-		return false;
+	ok = drm_plane_add(req, &plane->atomic.plane, plane->crtc, plane->atomic.fb, 0, 0, plane->mode.width, plane->mode.height);
+
+	wl_array_for_each (overlay, &plane->atomic.overlays)
+		ok &= drm_plane_add(req, &overlay->plane, plane->crtc, overlay->fb, overlay->x, overlay->y, overlay->width, overlay->height);
+
+	wl_array_for_each (mirror, &plane->mirrors)
+		ok &= drm_plane_add(req, &mirror->atomic.plane, mirror->crtc, plane->atomic.fb, 0, 0, plane->mode.width, plane->mode.height);
+
+	return ok;
+}
+
+static bool
+add_cursor(struct primary_plane *plane, drmModeAtomicReq *req)
+{
+	struct mirror *mirror;
+	bool ok;
+
+	ok = drm_plane_add(req, &plane->atomic.cursor_plane, plane->crtc, plane->atomic.cursor.fb,
+	                   plane->atomic.cursor.x, plane->atomic.cursor.y,
+	                   plane->atomic.cursor.width, plane->atomic.cursor.height);
+
+	wl_array_for_each (mirror, &plane->mirrors) {
+		if (!mirror->atomic.cursor_plane.id)
+			continue;
+		ok &= drm_plane_add(req, &mirror->atomic.cursor_plane, mirror->crtc, plane->atomic.cursor.fb,
+		                    plane->atomic.cursor.x, plane->atomic.cursor.y,
+		                    plane->atomic.cursor.width, plane->atomic.cursor.height);
 	}
 
-	return true;
+	return ok;
 }
 
+/**
+ * Builds and submits an atomic request containing the current framebuffer and
+ * cursor state of the CRTC, along with the mode if a modeset is needed. The
+ * request is checked with a test commit first if the configuration changed.
+ */
+static int
+atomic_commit(struct primary_plane *plane, bool frame)
+{
+	drmModeAtomicReq *req;
+	struct mirror *mirror;
+	uint32_t *connector, *property, flags = DRM_MODE_PAGE_FLIP_EVENT | DRM_MODE_ATOMIC_NONBLOCK;
+	bool test = plane->need_modeset || plane->atomic.cursor_changed || plane->vrr_dirty, ok = true;
+	bool async = frame && !test && plane->tearing && swc.drm->async_page_flip && plane->mirrors.size == 0;
+	int cursor, ret;
+
+	if (!(req = drmModeAtomicAlloc()))
+		return -ENOMEM;
+
+	if (plane->need_modeset) {
+		flags = DRM_MODE_ATOMIC_ALLOW_MODESET;
+		ok &= drmModeAtomicAddProperty(req, plane->crtc, plane->atomic.crtc_properties[DRM_CRTC_PROPERTY_ACTIVE], 1) >= 0;
+		ok &= drmModeAtomicAddProperty(req, plane->crtc, plane->atomic.crtc_properties[DRM_CRTC_PROPERTY_MODE_ID], plane->atomic.mode_blob) >= 0;
+
+		property = plane->atomic.connector_properties.data;
+		wl_array_for_each (connector, &plane->connectors)
+			ok &= drmModeAtomicAddProperty(req, *connector, *property++, plane->crtc) >= 0;
+
+		wl_array_for_each (mirror, &plane->mirrors) {
+			ok &= drmModeAtomicAddProperty(req, mirror->crtc, mirror->atomic.crtc_properties[DRM_CRTC_PROPERTY_ACTIVE], 1) >= 0;
+			ok &= drmModeAtomicAddProperty(req, mirror->crtc, mirror->atomic.crtc_properties[DRM_CRTC_PROPERTY_MODE_ID], mirror->atomic.mode_blob) >= 0;
+			ok &= drmModeAtomicAddProperty(req, mirror->connector, mirror->atomic.connector_properties[DRM_CONNECTOR_PROPERTY_CRTC_ID], mirror->crtc) >= 0;
+		}
+	}
+
+	if (plane->vrr_dirty)
+		ok &= drmModeAtomicAddProperty(req, plane->crtc, plane->vrr_property, plane->vrr) >= 0;
+
+	ok &= add_planes(plane, req);
+
+	cursor = drmModeAtomicGetCursor(req);
+	if (plane->atomic.cursor_plane.id)
+		ok &= add_cursor(plane, req);
+
+	if (!ok) {
+		ret = -ENOMEM;
+		goto done;
+	}
+
+	if (test && drmModeAtomicCommit(swc.drm->fd, req, flags | DRM_MODE_ATOMIC_TEST_ONLY, NULL) < 0) {
+		/* If the driver won't enable a variable refresh rate, stop trying
+		 * and commit without it. */
+		if (plane->vrr_dirty && plane->vrr) {
+			WARNING("Could not enable variable refresh rate: %s\n", strerror(errno));
+			plane->vrr_capable = false;
+			plane->vrr = false;
+			plane->vrr_dirty = false;
+			drmModeAtomicFree(req);
+			return atomic_commit(plane, frame);
+		}
+
+		if (!plane->atomic.cursor.fb) {
+			ERROR("Atomic test commit failed: %s\n", strerror(errno));
+			ret = -errno;
+			goto done;
+		}
+
+		/* Try again without the cursor. */
+		WARNING("Atomic test commit failed, disabling cursor: %s\n", strerror(errno));
+		drmModeAtomicSetCursor(req, cursor);
+		plane->atomic.cursor.fb = 0;
+		add_cursor(plane, req);
+
+		if (drmModeAtomicCommit(swc.drm->fd, req, flags | DRM_MODE_ATOMIC_TEST_ONLY, NULL) < 0) {
+			ERROR("Atomic test commit failed: %s\n", strerror(errno));
+			ret = -errno;
+			goto done;
+		}
+	}
+
+	/* Drivers may refuse asynchronous commits that change more than the
+	 * framebuffer, so fall back to waiting for the vertical blank. */
+	if (!async || drmModeAtomicCommit(swc.drm->fd, req, flags | DRM_MODE_PAGE_FLIP_ASYNC, &plane->drm_handler) < 0) {
+		async = false;
+
+		if (drmModeAtomicCommit(swc.drm->fd, req, flags, &plane->drm_handler) < 0) {
+			ERROR("Atomic commit failed: %s\n", strerror(errno));
+			ret = -errno;
+			goto done;
+		}
+	}
+
+	plane->atomic.cursor_dirty = false;
+	plane->atomic.cursor_changed = false;
+	plane->vrr_dirty = false;
+	if (frame)
+		plane->async_flip = async;
+
+	if (plane->need_modeset) {
+		/* Modesets are blocking, so no event will be sent. */
+		plane->need_modeset = false;
+		wl_event_loop_add_idle(swc.event_loop, &send_frame, plane);
+	} else {
+		/* Every CRTC in the commit sends its own event. */
+		plane->atomic.commit_pending = true;
+		plane->atomic.frame_pending = frame;
+		plane->flips_pending = 1 + plane->mirrors.size / sizeof(struct mirror);
+	}
+
+	ret = 0;
+
+done:
+	drmModeAtomicFree(req);
+	return ret;
+}
+
+uint32_t
+primary_plane_num_overlays(struct primary_plane *plane)
+{
+	/* Overlays would only show up on one of the mirrored CRTCs. */
+	if (!swc.drm->atomic || plane->mirrors.size > 0)
+		return 0;
+	return plane->atomic.overlays.size / sizeof(struct overlay_plane);
+}
+
+bool
+primary_plane_set_overlay(struct primary_plane *plane, uint32_t index, uint32_t fb, int32_t x, int32_t y, uint32_t width, uint32_t height)
+{
+	struct overlay_plane *overlay = (struct overlay_plane *)plane->atomic.overlays.data + index;
+	drmModeAtomicReq *req;
+	bool ok = false;
+
+	overlay->fb = fb;
+	overlay->x = x;
+	overlay->y = y;
+	overlay->width = width;
+	overlay->height = height;
+
+	if (!fb)
+		return true;
+
+	/* We can only test against the configuration of a CRTC that is already
+	 * set up. */
+	if (plane->need_modeset || !plane->atomic.fb)
+		goto done;
+
+	if (!(req = drmModeAtomicAlloc()))
+		goto done;
+
+	if (add_planes(plane, req) && (!plane->atomic.cursor_plane.id || add_cursor(plane, req)))
+		ok = drmModeAtomicCommit(swc.drm->fd, req, DRM_MODE_ATOMIC_TEST_ONLY, NULL) == 0;
+
+	drmModeAtomicFree(req);
+
+done:
+	if (!ok)
+		overlay->fb = 0;
+
+	return ok;
+}
+
+void
+primary_plane_clear_overlays(struct primary_plane *plane)
+{
+	struct overlay_plane *overlay;
+
+	wl_array_for_each (overlay, &plane->atomic.overlays)
+		overlay->fb = 0;
+}
+
+void
+primary_plane_set_vrr(struct primary_plane *plane, bool vrr)
+{
+	vrr &= plane->vrr_capable;
+	if (vrr == plane->vrr)
+		return;
+
+	plane->vrr = vrr;
+	plane->vrr_dirty = true;
+}
+
+/**
+ * Turns off the CRTC and its mirrors by setting the DPMS property of their
+ * connectors, or by deactivating them with atomic modesetting.
+ */
+static int
+power_off(struct primary_plane *plane)
+{
+	drmModeAtomicReq *req;
+	struct mirror *mirror;
+	uint32_t *connector, property;
+	bool ok = true;
+	int ret = 0;
+
+	if (swc.headless)
+		return 0;
+
+	if (!swc.drm->atomic) {
+		wl_array_for_each (connector, &plane->connectors) {
+			if (!drm_get_property(*connector, DRM_MODE_OBJECT_CONNECTOR, "DPMS", &property, NULL))
+				ret = -ENOTSUP;
+			else if (drmModeConnectorSetProperty(swc.drm->fd, *connector, property, DRM_MODE_DPMS_OFF) < 0)
+				ret = -errno;
+		}
+		wl_array_for_each (mirror, &plane->mirrors) {
+			if (drm_get_property(mirror->connector, DRM_MODE_OBJECT_CONNECTOR, "DPMS", &property, NULL))
+				drmModeConnectorSetProperty(swc.drm->fd, mirror->connector, property, DRM_MODE_DPMS_OFF);
+		}
+
+		return ret;
+	}
+
+	if (!(req = drmModeAtomicAlloc()))
+		return -ENOMEM;
+
+	ok &= drmModeAtomicAddProperty(req, plane->crtc, plane->atomic.crtc_properties[DRM_CRTC_PROPERTY_ACTIVE], 0) >= 0;
+	wl_array_for_each (mirror, &plane->mirrors)
+		ok &= drmModeAtomicAddProperty(req, mirror->crtc, mirror->atomic.crtc_properties[DRM_CRTC_PROPERTY_ACTIVE], 0) >= 0;
+
+	if (!ok)
+		ret = -ENOMEM;
+	else if (drmModeAtomicCommit(swc.drm->fd, req, DRM_MODE_ATOMIC_ALLOW_MODESET, NULL) < 0)
+		ret = -errno;
+
+	drmModeAtomicFree(req);
+	return ret;
+}
+
+/**
+ * Prepares the CRTC to be set up again with the next frame.
+ */
 static void
-framebuffer_destroy(struct wld_destructor *destructor)
+power_on(struct primary_plane *plane)
 {
-	struct framebuffer *framebuffer = wl_container_of(destructor, framebuffer, destructor);
+	struct mirror *mirror;
+	uint32_t *connector, property;
+
+	/* Legacy modesets don't necessarily change the DPMS state of the
+	 * connectors. */
+	if (!swc.headless && !swc.drm->atomic) {
+		wl_array_for_each (connector, &plane->connectors) {
+			if (drm_get_property(*connector, DRM_MODE_OBJECT_CONNECTOR, "DPMS", &property, NULL))
+				drmModeConnectorSetProperty(swc.drm->fd, *connector, property, DRM_MODE_DPMS_ON);
+		}
+		wl_array_for_each (mirror, &plane->mirrors) {
+			if (drm_get_property(mirror->connector, DRM_MODE_OBJECT_CONNECTOR, "DPMS", &property, NULL))
+				drmModeConnectorSetProperty(swc.drm->fd, mirror->connector, property, DRM_MODE_DPMS_ON);
+		}
+	}
 
-	drmModeRmFB(swc.drm->fd, framebuffer->id);
-	free(framebuffer);
+	plane->need_modeset = true;
+	/* The vertical blanks stopped while the CRTC was off. */
+	plane->last_vblank = 0;
 }
 
-static bool
-update(struct view *view)
+bool
+primary_plane_set_power(struct primary_plane *plane, bool on)
 {
+	int ret;
+
+	if (plane->off == !on)
+		return true;
+
+	if (on) {
+		plane->off = false;
+		power_on(plane);
+		return true;
+	}
+
+	/* If the session is inactive, the CRTC is turned off when it becomes
+	 * active again. */
+	if (swc.active && (ret = power_off(plane)) < 0) {
+		ERROR("Could not turn off CRTC %u: %s\n", plane->crtc, strerror(-ret));
+		return false;
+	}
+
+	plane->off = true;
+
+	/* A frame waiting for a cursor commit to complete would never be
+	 * committed now. */
+	if (plane->atomic.frame_queued) {
+		plane->atomic.frame_queued = false;
+		wl_event_loop_add_idle(swc.event_loop, &send_frame, plane);
+	}
+
 	return true;
 }
 
-static void
-send_frame(void *data)
+bool
+primary_plane_has_atomic_cursor(struct primary_plane *plane)
 {
-	struct primary_plane *plane = data;
+	return swc.drm->atomic && plane->atomic.cursor_plane.id != 0;
+}
+
+/**
+ * Commits a change of the cursor state, unless it can be folded into a commit
+ * that will happen anyway.
+ */
+static int
+update_cursor(struct primary_plane *plane)
+{
+	plane->atomic.cursor_dirty = true;
+
+	if (!swc.active || plane->off || plane->need_modeset || plane->atomic.commit_pending)
+		return 0;
 
-	view_frame(&plane->view, get_time());
+	return atomic_commit(plane, false);
+}
+
+int
+primary_plane_set_cursor(struct primary_plane *plane, uint32_t fb, uint32_t width, uint32_t height)
+{
+	if (plane->atomic.cursor.fb != fb || plane->atomic.cursor.width != width || plane->atomic.cursor.height != height)
+		plane->atomic.cursor_changed = true;
+
+	plane->atomic.cursor.fb = fb;
+	plane->atomic.cursor.width = width;
+	plane->atomic.cursor.height = height;
+
+	return update_cursor(plane);
+}
+
+int
+primary_plane_move_cursor(struct primary_plane *plane, int32_t x, int32_t y)
+{
+	plane->atomic.cursor.x = x;
+	plane->atomic.cursor.y = y;
+
+	return update_cursor(plane);
 }
 
 static int
 attach(struct view *view, struct wld_buffer *buffer)
 {
 	struct primary_plane *plane = wl_container_of(view, plane, view);
-	union wld_object object;
+	struct mirror *mirror;
+	uint32_t fb;
 	int ret;
 
-	if (!wld_export(buffer, WLD_USER_OBJECT_FRAMEBUFFER, &object)) {
-		struct framebuffer *framebuffer;
+	/* Nothing is displayed while the CRTC is off, so the frame is complete
+	 * right away. */
+	if (plane->off)
+		return wl_event_loop_add_idle(swc.event_loop, &send_frame, plane) ? 0 : -ENOMEM;
 
-		if (!wld_export(buffer, WLD_DRM_OBJECT_HANDLE, &object)) {
-			ERROR("Could not get buffer handle\n");
-			return -EINVAL;
-		}
+	if (swc.headless) {
+		plane->async_flip = plane->tearing && swc.drm->async_page_flip;
+		if (plane->async_flip)
+			return wl_event_loop_add_idle(swc.event_loop, &send_frame, plane) ? 0 : -ENOMEM;
+		return schedule_vblank(plane);
+	}
 
-		if (!(framebuffer = malloc(sizeof(*framebuffer))))
-			return -ENOMEM;
+	if (!drm_get_framebuffer(buffer, WLD_FORMAT_XRGB8888, &fb))
+		return -EINVAL;
 
-		ret = drmModeAddFB(swc.drm->fd, buffer->width, buffer->height, 24, 32, buffer->pitch, object.u32, &framebuffer->id);
+	if (swc.drm->atomic) {
+		plane->atomic.fb = fb;
 
-		if (ret < 0) {
-			free(framebuffer);
-			return ret;
+		/* A commit for the cursor is still in flight, so wait for it to
+		 * complete before committing the new frame. */
+		if (plane->atomic.commit_pending) {
+			plane->atomic.frame_queued = true;
+			return 0;
 		}
 
-		framebuffer->exporter.export = &framebuffer_export;
-		wld_buffer_add_exporter(buffer, &framebuffer->exporter);
-		framebuffer->destructor.destroy = &framebuffer_destroy;
-		wld_buffer_add_destructor(buffer, &framebuffer->destructor);
+		return atomic_commit(plane, true);
+	}
 
-		object.u32 = framebuffer->id;
+	if (plane->vrr_dirty) {
+		if (drmModeObjectSetProperty(swc.drm->fd, plane->crtc, DRM_MODE_OBJECT_CRTC, plane->vrr_property, plane->vrr) < 0 && plane->vrr) {
+			WARNING("Could not enable variable refresh rate: %s\n", strerror(errno));
+			plane->vrr_capable = false;
+			plane->vrr = false;
+		}
+		plane->vrr_dirty = false;
 	}
 
 	if (plane->need_modeset) {
-		ret = drmModeSetCrtc(swc.drm->fd, plane->crtc, object.u32, 0, 0, plane->connectors.data, plane->connectors.size / 4, &plane->mode.info);
+		ret = drmModeSetCrtc(swc.drm->fd, plane->crtc, fb, 0, 0, plane->connectors.data, plane->connectors.size / 4, &plane->mode.info);
 
 		if (ret == 0) {
 			wl_event_loop_add_idle(swc.event_loop, &send_frame, plane);
 			plane->need_modeset = false;
+			plane->async_flip = false;
 		} else {
 			ERROR("Could not set CRTC to next framebuffer: %s\n", strerror(-ret));
 			return ret;
 		}
+
+		wl_array_for_each (mirror, &plane->mirrors) {
+			if (drmModeSetCrtc(swc.drm->fd, mirror->crtc, fb, 0, 0, &mirror->connector, 1, &mirror->mode.info) < 0)
+				WARNING("Could not set mirrored CRTC %u: %s\n", mirror->crtc, strerror(errno));
+		}
 	} else {
-		ret = drmModePageFlip(swc.drm->fd, plane->crtc, object.u32, DRM_MODE_PAGE_FLIP_EVENT, &plane->drm_handler);
+		plane->async_flip = plane->tearing && swc.drm->async_page_flip && plane->mirrors.size == 0;
+
+		/* Drivers may refuse some asynchronous flips, so fall back to
+		 * waiting for the vertical blank. */
+		if (!plane->async_flip || drmModePageFlip(swc.drm->fd, plane->crtc, fb, DRM_MODE_PAGE_FLIP_EVENT | DRM_MODE_PAGE_FLIP_ASYNC, &plane->drm_handler) < 0) {
+			plane->async_flip = false;
+			ret = drmModePageFlip(swc.drm->fd, plane->crtc, fb, DRM_MODE_PAGE_FLIP_EVENT, &plane->drm_handler);
+		} else {
+			ret = 0;
+		}
 
 		if (ret < 0) {
 			ERROR("Page flip failed: %s\n", strerror(errno));
 			return ret;
 		}
+
+		/* The mirrored CRTCs are flipped right after ours, so they usually
+		 * make the same vertical blank. */
+		plane->flips_pending = 1;
+		wl_array_for_each (mirror, &plane->mirrors) {
+			if (drmModePageFlip(swc.drm->fd, mirror->crtc, fb, DRM_MODE_PAGE_FLIP_EVENT, &plane->drm_handler) == 0)
+				++plane->flips_pending;
+			else
+				WARNING("Page flip of mirrored CRTC %u failed: %s\n", mirror->crtc, strerror(errno));
+		}
 	}
 
 	return 0;
@@ -152,10 +597,96 @@ const static struct view_impl view_impl = {
 };
 
 static void
-handle_page_flip(struct drm_handler *handler, uint32_t time)
+handle_page_flip(struct drm_handler *handler, uint32_t crtc, uint64_t time, uint32_t sequence)
 {
 	struct primary_plane *plane = wl_container_of(handler, plane, drm_handler);
-	view_frame(&plane->view, time);
+
+	/* Wait until all the mirrored CRTCs have flipped, but report the time of
+	 * our own. */
+	if (crtc == plane->crtc) {
+		set_sequence(plane, sequence);
+		plane->flip_time = time;
+	}
+	if (plane->flips_pending > 1) {
+		--plane->flips_pending;
+		return;
+	}
+	plane->flips_pending = 0;
+	time = plane->flip_time;
+
+	if (!swc.drm->atomic) {
+		finish_frame(plane, time);
+		return;
+	}
+
+	plane->atomic.commit_pending = false;
+
+	if (plane->atomic.frame_pending) {
+		plane->atomic.frame_pending = false;
+		finish_frame(plane, time);
+	} else {
+		plane->last_vblank = time;
+	}
+
+	/* Submit any frame or cursor changes that came in while the commit was
+	 * in flight, unless the frame handlers already did. */
+	if (!plane->atomic.commit_pending && swc.active && !plane->off) {
+		if (plane->atomic.frame_queued) {
+			plane->atomic.frame_queued = false;
+			atomic_commit(plane, true);
+		} else if (plane->atomic.cursor_dirty) {
+			atomic_commit(plane, false);
+		}
+	}
+}
+
+bool
+primary_plane_set_mode(struct primary_plane *plane, struct mode *mode)
+{
+	uint32_t blob;
+
+	if (plane->mirrors.size > 0 && (mode->width != plane->mode.width || mode->height != plane->mode.height)) {
+		ERROR("Cannot change the size of a mirrored mode\n");
+		return false;
+	}
+
+	if (swc.drm->atomic) {
+		if (drmModeCreatePropertyBlob(swc.drm->fd, &mode->info, sizeof(mode->info), &blob) < 0) {
+			ERROR("Could not create mode property blob: %s\n", strerror(errno));
+			return false;
+		}
+
+		drmModeDestroyPropertyBlob(swc.drm->fd, plane->atomic.mode_blob);
+		plane->atomic.mode_blob = blob;
+	}
+
+	plane->mode = *mode;
+	plane->need_modeset = true;
+	/* The vertical blanks of the new mode are not in phase with the old
+	 * ones, so don't predict them until we have seen one. */
+	plane->last_vblank = 0;
+
+	return true;
+}
+
+uint64_t
+primary_plane_next_vblank(struct primary_plane *plane, uint64_t time)
+{
+	uint64_t interval;
+
+	/* With a variable refresh rate, the driver starts a refresh when a new
+	 * frame arrives, whether or not a window covers the screen, so the
+	 * vertical blanks don't follow the refresh rate of the mode. */
+	if (plane->last_vblank == 0 || plane->mode.refresh == 0 || plane->vrr)
+		return 0;
+
+	/* Assume that the vertical blanks have continued at the refresh rate of
+	 * the mode since the last one we saw. */
+	interval = 1000000000000ull / plane->mode.refresh;
+	if (time < plane->last_vblank)
+		return plane->last_vblank + interval;
+
+	return plane->last_vblank + ((time - plane->last_vblank) / interval + 1) * interval;
 }
 
 static void
@@ -167,16 +698,240 @@ handle_swc_event(struct wl_listener *listener, void *data)
 	switch (event->type) {
 	case SWC_EVENT_ACTIVATED:
 		plane->need_modeset = true;
+		plane->atomic.commit_pending = false;
+		plane->atomic.frame_pending = false;
+		plane->atomic.frame_queued = false;
+		/* Another DRM master may have changed the refresh rate setting. */
+		plane->vrr_dirty = plane->vrr_property != 0;
+		/* It may also have turned the CRTC back on. */
+		if (plane->off && power_off(plane) < 0)
+			WARNING("Could not turn off CRTC %u\n", plane->crtc);
 		break;
 	}
 }
 
+/**
+ * Finds out whether all the connectors of the CRTC support variable refresh
+ * rates. It starts out disabled.
+ */
+static void
+vrr_initialize(struct primary_plane *plane)
+{
+	uint32_t *connector, property;
+	uint64_t capable;
+
+	plane->vrr_capable = false;
+	plane->vrr = false;
+	plane->vrr_dirty = false;
+	plane->vrr_property = 0;
+
+	if (swc.headless)
+		return;
+
+	wl_array_for_each (connector, &plane->connectors) {
+		if (!drm_get_property(*connector, DRM_MODE_OBJECT_CONNECTOR, "vrr_capable", &property, &capable) || !capable)
+			return;
+	}
+
+	if (!drm_get_property(plane->crtc, DRM_MODE_OBJECT_CRTC, "VRR_ENABLED", &plane->vrr_property, NULL))
+		return;
+
+	DEBUG("CRTC %u supports variable refresh rates\n", plane->crtc);
+	plane->vrr_capable = true;
+	plane->vrr_dirty = true;
+}
+
+static void
+release_overlays(struct primary_plane *plane)
+{
+	struct overlay_plane *overlay;
+
+	wl_array_for_each (overlay, &plane->atomic.overlays)
+		drm_release_plane(&overlay->plane);
+	wl_array_release(&plane->atomic.overlays);
+}
+
+static bool
+atomic_initialize(struct primary_plane *plane)
+{
+	struct overlay_plane *overlay;
+	uint32_t *connector, *property;
+
+	wl_array_init(&plane->atomic.connector_properties);
+	wl_array_init(&plane->atomic.overlays);
+
+	if (!drm_find_plane(plane->crtc, DRM_PLANE_TYPE_PRIMARY, &plane->atomic.plane)) {
+		ERROR("Could not find primary plane for CRTC %u\n", plane->crtc);
+		goto error0;
+	}
+
+	/* Without a cursor plane, we fall back to the legacy cursor ioctls. */
+	if (!drm_find_plane(plane->crtc, DRM_PLANE_TYPE_CURSOR, &plane->atomic.cursor_plane))
+		plane->atomic.cursor_plane.id = 0;
+
+	while (plane->atomic.overlays.size / sizeof(*overlay) < MAX_OVERLAYS) {
+		if (!(overlay = wl_array_add(&plane->atomic.overlays, sizeof(*overlay))))
+			break;
+
+		if (!drm_find_plane(plane->crtc, DRM_PLANE_TYPE_OVERLAY, &overlay->plane)) {
+			plane->atomic.overlays.size -= sizeof(*overlay);
+			break;
+		}
+
+		overlay->fb = 0;
+	}
+
+	if (!drm_get_crtc_properties(plane->crtc, plane->atomic.crtc_properties)) {
+		ERROR("Could not get properties of CRTC %u\n", plane->crtc);
+		goto error1;
+	}
+
+	wl_array_for_each (connector, &plane->connectors) {
+		if (!(property = wl_array_add(&plane->atomic.connector_properties, sizeof(*property)))
+		    || !drm_get_connector_properties(*connector, property)) {
+			ERROR("Could not get properties of connector %u\n", *connector);
+			goto error2;
+		}
+	}
+
+	if (drmModeCreatePropertyBlob(swc.drm->fd, &plane->mode.info, sizeof(plane->mode.info), &plane->atomic.mode_blob) < 0) {
+		ERROR("Could not create mode property blob: %s\n", strerror(errno));
+		goto error2;
+	}
+
+	return true;
+
+error2:
+	wl_array_release(&plane->atomic.connector_properties);
+error1:
+	release_overlays(plane);
+	if (plane->atomic.cursor_plane.id)
+		drm_release_plane(&plane->atomic.cursor_plane);
+	drm_release_plane(&plane->atomic.plane);
+error0:
+	return false;
+}
+
+static bool
+mirror_atomic_initialize(struct mirror *mirror)
+{
+	if (!drm_find_plane(mirror->crtc, DRM_PLANE_TYPE_PRIMARY, &mirror->atomic.plane)) {
+		ERROR("Could not find primary plane for CRTC %u\n", mirror->crtc);
+		goto error0;
+	}
+
+	if (!drm_find_plane(mirror->crtc, DRM_PLANE_TYPE_CURSOR, &mirror->atomic.cursor_plane))
+		mirror->atomic.cursor_plane.id = 0;
+
+	if (!drm_get_crtc_properties(mirror->crtc, mirror->atomic.crtc_properties)) {
+		ERROR("Could not get properties of CRTC %u\n", mirror->crtc);
+		goto error1;
+	}
+
+	if (!drm_get_connector_properties(mirror->connector, mirror->atomic.connector_properties)) {
+		ERROR("Could not get properties of connector %u\n", mirror->connector);
+		goto error1;
+	}
+
+	if (drmModeCreatePropertyBlob(swc.drm->fd, &mirror->mode.info, sizeof(mirror->mode.info), &mirror->atomic.mode_blob) < 0) {
+		ERROR("Could not create mode property blob: %s\n", strerror(errno));
+		goto error1;
+	}
+
+	return true;
+
+error1:
+	if (mirror->atomic.cursor_plane.id)
+		drm_release_plane(&mirror->atomic.cursor_plane);
+	drm_release_plane(&mirror->atomic.plane);
+error0:
+	return false;
+}
+
+static void
+mirror_finalize(struct mirror *mirror)
+{
+	drmModeCrtcPtr crtc = mirror->original_crtc_state;
+
+	if (swc.drm->atomic) {
+		drmModeDestroyPropertyBlob(swc.drm->fd, mirror->atomic.mode_blob);
+		if (mirror->atomic.cursor_plane.id)
+			drm_release_plane(&mirror->atomic.cursor_plane);
+		drm_release_plane(&mirror->atomic.plane);
+	}
+
+	drmModeSetCrtc(swc.drm->fd, crtc->crtc_id, crtc->buffer_id, crtc->x, crtc->y, NULL, 0, &crtc->mode);
+	drmModeFreeCrtc(crtc);
+}
+
+bool
+primary_plane_add_mirror(struct primary_plane *plane, uint32_t crtc, uint32_t connector, struct mode *mode)
+{
+	struct mirror *mirror;
+
+	if (!(mirror = wl_array_add(&plane->mirrors, sizeof(*mirror))))
+		goto error0;
+
+	mirror->crtc = crtc;
+	mirror->connector = connector;
+	mirror->mode = *mode;
+
+	if (!(mirror->original_crtc_state = drmModeGetCrtc(swc.drm->fd, crtc))) {
+		ERROR("Failed to get CRTC state for CRTC %u: %s\n", crtc, strerror(errno));
+		goto error1;
+	}
+
+	if (swc.drm->atomic && !mirror_atomic_initialize(mirror))
+		goto error2;
+
+	/* The refresh rate of the CRTCs must stay in step. */
+	primary_plane_set_vrr(plane, false);
+	plane->vrr_capable = false;
+	plane->need_modeset = true;
+
+	return true;
+
+error2:
+	drmModeFreeCrtc(mirror->original_crtc_state);
+error1:
+	plane->mirrors.size -= sizeof(*mirror);
+error0:
+	return false;
+}
+
+static void
+atomic_finalize(struct primary_plane *plane)
+{
+	drmModeDestroyPropertyBlob(swc.drm->fd, plane->atomic.mode_blob);
+	wl_array_release(&plane->atomic.connector_properties);
+	release_overlays(plane);
+	if (plane->atomic.cursor_plane.id)
+		drm_release_plane(&plane->atomic.cursor_plane);
+	drm_release_plane(&plane->atomic.plane);
+}
+
 bool
 primary_plane_initialize(struct primary_plane *plane, uint32_t crtc, struct mode *mode, uint32_t *connectors, uint32_t num_connectors)
 {
 	uint32_t *plane_connectors;
 
-	if (!(plane->original_crtc_state = drmModeGetCrtc(swc.drm->fd, crtc))) {
+	if (swc.headless) {
+		plane->original_crtc_state = NULL;
+		plane->vblank_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+
+		if (plane->vblank_fd == -1) {
+			ERROR("Failed to create vblank timer: %s\n", strerror(errno));
+			goto error0;
+		}
+
+		plane->vblank_source = wl_event_loop_add_fd(swc.event_loop, plane->vblank_fd, WL_EVENT_READABLE, &handle_vblank_timer, plane);
+
+		if (!plane->vblank_source) {
+			ERROR("Failed to create vblank timer event source\n");
+			close(plane->vblank_fd);
+			goto error0;
+		}
+	} else if (!(plane->original_crtc_state = drmModeGetCrtc(swc.drm->fd, crtc))) {
 		ERROR("Failed to get CRTC state for CRTC %u: %s\n", crtc, strerror(errno));
 		goto error0;
 	}
@@ -192,18 +947,41 @@ primary_plane_initialize(struct primary_plane *plane, uint32_t crtc, struct mode
 	memcpy(plane_connectors, connectors, num_connectors * sizeof(connectors[0]));
 	plane->crtc = crtc;
 	plane->need_modeset = true;
+	plane->last_vblank = 0;
+	plane->msc = 0;
+	plane->hardware_clock = false;
+	plane->tearing = false;
+	plane->async_flip = false;
+	plane->off = false;
 	view_initialize(&plane->view, &view_impl);
 	plane->view.geometry.width = mode->width;
 	plane->view.geometry.height = mode->height;
 	plane->drm_handler.page_flip = &handle_page_flip;
 	plane->swc_listener.notify = &handle_swc_event;
 	plane->mode = *mode;
+	memset(&plane->atomic, 0, sizeof(plane->atomic));
+	wl_array_init(&plane->mirrors);
+	plane->flips_pending = 0;
+	plane->flip_time = 0;
+	vrr_initialize(plane);
+
+	if (swc.drm->atomic && !atomic_initialize(plane))
+		goto error2;
+
 	wl_signal_add(&swc.event_signal, &plane->swc_listener);
 
 	return true;
 
+error2:
+	wl_array_release(&plane->mirrors);
+	wl_array_release(&plane->connectors);
 error1:
-	drmModeFreeCrtc(plane->original_crtc_state);
+	if (swc.headless) {
+		wl_event_source_remove(plane->vblank_source);
+		close(plane->vblank_fd);
+	} else {
+		drmModeFreeCrtc(plane->original_crtc_state);
+	}
 error0:
 	return false;
 }
@@ -211,7 +989,22 @@ error0:
 void
 primary_plane_finalize(struct primary_plane *plane)
 {
+	struct mirror *mirror;
+
+	wl_array_for_each (mirror, &plane->mirrors)
+		mirror_finalize(mirror);
+	wl_array_release(&plane->mirrors);
 	wl_array_release(&plane->connectors);
+
+	if (swc.headless) {
+		wl_event_source_remove(plane->vblank_source);
+		close(plane->vblank_fd);
+		return;
+	}
+
+	if (swc.drm->atomic)
+		atomic_finalize(plane);
+
 	drmModeCrtcPtr crtc = plane->original_crtc_state;
 	drmModeSetCrtc(swc.drm->fd, crtc->crtc_id, crtc->buffer_id, crtc->x, crtc->y, NULL, 0, &crtc->mode);
 	drmModeFreeCrtc(crtc);
@@ -32,6 +32,27 @@
 #include <stdbool.h>
 #include <wayland-server.h>
 
+struct overlay_plane {
+	struct drm_plane plane;
+	uint32_t fb, width, height;
+	int32_t x, y;
+};
+
+/* Another CRTC displaying the same framebuffers, in mirror mode. Its mode has
+ * the same size as that of the primary plane. */
+struct mirror {
+	uint32_t crtc, connector;
+	drmModeCrtcPtr original_crtc_state;
+	struct mode mode;
+
+	struct {
+		struct drm_plane plane, cursor_plane;
+		uint32_t crtc_properties[DRM_CRTC_NUM_PROPERTIES];
+		uint32_t connector_properties[DRM_CONNECTOR_NUM_PROPERTIES];
+		uint32_t mode_blob;
+	} atomic;
+};
+
 struct primary_plane {
 	uint32_t crtc;
 	drmModeCrtcPtr original_crtc_state;
@@ -41,9 +62,126 @@ struct primary_plane {
 	bool need_modeset;
 	struct drm_handler drm_handler;
 	struct wl_listener swc_listener;
+
+	/* The mirrored CRTCs (struct mirror). A frame is complete when all of
+	 * them have flipped, which is tracked by the number of page flip events
+	 * still to come, and the time and counter of our own CRTC's flip. */
+	struct wl_array mirrors;
+	uint32_t flips_pending;
+	uint64_t flip_time;
+
+	/* The time of the last vertical blank in nanoseconds on the monotonic
+	 * clock, or 0 if no frame has been displayed yet. */
+	uint64_t last_vblank;
+
+	/* The number of vertical blanks before the last one, and whether it and
+	 * the time were reported by the hardware. */
+	uint64_t msc;
+	bool hardware_clock;
+
+	/* Whether new frames should be displayed immediately rather than at the
+	 * next vertical blank, and whether the last one was. */
+	bool tearing, async_flip;
+
+	/* Whether the connectors support variable refresh rates, whether the
+	 * CRTC should use one, and whether that needs to be committed. */
+	bool vrr_capable, vrr, vrr_dirty;
+	/* The VRR_ENABLED property of the CRTC. */
+	uint32_t vrr_property;
+
+	/* Whether the CRTC has been turned off to save power. */
+	bool off;
+
+	/* For headless screens, a timer emulating the vertical blank. */
+	int vblank_fd;
+	struct wl_event_source *vblank_source;
+
+	/* With atomic modesetting, the framebuffer and the cursor are committed
+	 * together in a single request per frame. */
+	struct {
+		struct drm_plane plane, cursor_plane;
+		uint32_t crtc_properties[DRM_CRTC_NUM_PROPERTIES];
+		/* The CRTC_ID property of each connector. */
+		struct wl_array connector_properties;
+		uint32_t mode_blob;
+		uint32_t fb;
+
+		/* The overlay planes claimed for this CRTC (struct overlay_plane). */
+		struct wl_array overlays;
+
+		struct {
+			uint32_t fb, width, height;
+			int32_t x, y;
+		} cursor;
+
+		/* Whether the cursor has changed since the last commit, and whether
+		 * its framebuffer or size changed, requiring a test commit. */
+		bool cursor_dirty, cursor_changed;
+
+		/* Whether a commit is in flight, whether it contains a new frame,
+		 * and whether a new frame is waiting for it to complete. */
+		bool commit_pending, frame_pending, frame_queued;
+	} atomic;
 };
 
 bool primary_plane_initialize(struct primary_plane *plane, uint32_t crtc, struct mode *mode, uint32_t *connectors, uint32_t num_connectors);
 void primary_plane_finalize(struct primary_plane *plane);
 
+/**
+ * Displays the frames of the plane on another CRTC and connector as well,
+ * using a mode of the same size. Mirrored planes don't use overlays,
+ * asynchronous page flips or variable refresh rates.
+ */
+bool primary_plane_add_mirror(struct primary_plane *plane, uint32_t crtc, uint32_t connector, struct mode *mode);
+
+/**
+ * Switches the CRTC to another mode, which is set along with the next frame.
+ * That frame must have the size of the new mode. Mirrored planes can only
+ * change to a mode of the same size.
+ */
+bool primary_plane_set_mode(struct primary_plane *plane, struct mode *mode);
+
+/**
+ * Returns the time in nanoseconds on the monotonic clock of the next vertical
+ * blank after the specified time, or 0 if it can't be predicted, as is the
+ * case while a variable refresh rate is enabled.
+ */
+uint64_t primary_plane_next_vblank(struct primary_plane *plane, uint64_t time);
+
+/**
+ * Returns whether the cursor of this plane's CRTC is updated as part of its
+ * atomic commits.
+ */
+bool primary_plane_has_atomic_cursor(struct primary_plane *plane);
+
+/**
+ * Returns the number of overlay planes that can be assigned to client buffers.
+ */
+uint32_t primary_plane_num_overlays(struct primary_plane *plane);
+
+/**
+ * Places a framebuffer on an overlay plane at the specified position relative
+ * to the CRTC, to be displayed with the next frame. The configuration is
+ * checked with a test commit, and if it fails, the overlay is disabled and
+ * false is returned.
+ */
+bool primary_plane_set_overlay(struct primary_plane *plane, uint32_t index, uint32_t fb, int32_t x, int32_t y, uint32_t width, uint32_t height);
+void primary_plane_clear_overlays(struct primary_plane *plane);
+
+/**
+ * Sets whether the CRTC uses a variable refresh rate, if the connectors
+ * support it. The change is committed with the next frame.
+ */
+void primary_plane_set_vrr(struct primary_plane *plane, bool vrr);
+
+/**
+ * Turns the CRTC and its mirrors off, or back on. While it is off, frames
+ * attached to the plane are not displayed, but complete right away. When it
+ * is turned on, the CRTC is set up again with the next frame.
+ */
+bool primary_plane_set_power(struct primary_plane *plane, bool on);
+
+int primary_plane_set_cursor(struct primary_plane *plane, uint32_t fb, uint32_t width, uint32_t height);
+int primary_plane_move_cursor(struct primary_plane *plane, int32_t x, int32_t y);
+
 #endif
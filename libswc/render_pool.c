@@ -0,0 +1,327 @@
+/* swc: libswc/render_pool.c
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "render_pool.h"
+#include "util.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <wayland-util.h>
+#include <wld/wld.h>
+
+/* Damage smaller than this many pixels is painted serially, since waking up
+ * the workers would cost more than it saves. */
+#define MIN_PARALLEL_AREA (256 * 256)
+
+#define MAX_THREADS 64
+
+struct band_job {
+	struct wld_buffer *target_buffer;
+	struct wl_array *ops;
+	int32_t y, band_height;
+	uint32_t num_bands;
+};
+
+static struct {
+	pthread_t threads[MAX_THREADS];
+	uint32_t num_threads;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t start, done;
+	uint32_t generation, remaining;
+	bool exit;
+
+	struct band_job job;
+	atomic_uint next_band;
+} pool;
+
+static pixman_format_code_t
+format_to_pixman(uint32_t format)
+{
+	switch (format) {
+	case WLD_FORMAT_XRGB8888:
+		return PIXMAN_x8r8g8b8;
+	case WLD_FORMAT_ARGB8888:
+		return PIXMAN_a8r8g8b8;
+	default:
+		return 0;
+	}
+}
+
+static pixman_image_t *
+create_image(struct wld_buffer *buffer)
+{
+	pixman_format_code_t format = format_to_pixman(buffer->format);
+
+	return pixman_image_create_bits_no_clear(format, buffer->width, buffer->height, buffer->map, buffer->pitch);
+}
+
+static void
+paint_band(struct band_job *job, uint32_t band)
+{
+	struct render_op *op;
+	pixman_image_t *target, *source;
+	pixman_region32_t region;
+	pixman_box32_t *extents, *boxes;
+	pixman_color_t color;
+	int num_boxes;
+
+	/* Each band gets its own images, since pixman images are not safe to use
+	 * from several threads at once. */
+	if (!(target = create_image(job->target_buffer)))
+		return;
+
+	pixman_region32_init_rect(&region, 0, job->y + band * job->band_height, job->target_buffer->width, job->band_height);
+
+	wl_array_for_each (op, job->ops) {
+		pixman_region32_t op_region;
+
+		pixman_region32_init(&op_region);
+		pixman_region32_intersect(&op_region, &op->region, &region);
+
+		if (!pixman_region32_not_empty(&op_region))
+			goto next;
+
+		if (op->buffer) {
+			if (!(source = create_image(op->buffer)))
+				goto next;
+			pixman_image_set_clip_region32(target, &op_region);
+			extents = pixman_region32_extents(&op_region);
+			pixman_image_composite32(PIXMAN_OP_SRC, source, NULL, target,
+			                         extents->x1 - op->x, extents->y1 - op->y, 0, 0,
+			                         extents->x1, extents->y1, extents->x2 - extents->x1, extents->y2 - extents->y1);
+			pixman_image_unref(source);
+		} else {
+			color.alpha = (op->color >> 24 & 0xff) * 0x101;
+			color.red = (op->color >> 16 & 0xff) * 0x101;
+			color.green = (op->color >> 8 & 0xff) * 0x101;
+			color.blue = (op->color & 0xff) * 0x101;
+			pixman_image_set_clip_region32(target, NULL);
+			boxes = pixman_region32_rectangles(&op_region, &num_boxes);
+			pixman_image_fill_boxes(PIXMAN_OP_SRC, target, &color, num_boxes, boxes);
+		}
+
+	next:
+		pixman_region32_fini(&op_region);
+	}
+
+	pixman_region32_fini(&region);
+	pixman_image_unref(target);
+}
+
+static void
+paint_bands(struct band_job *job)
+{
+	uint32_t band;
+
+	while ((band = atomic_fetch_add(&pool.next_band, 1)) < job->num_bands)
+		paint_band(job, band);
+}
+
+static void *
+run_worker(void *data)
+{
+	uint32_t generation = 0;
+
+	pthread_mutex_lock(&pool.mutex);
+
+	for (;;) {
+		while (pool.generation == generation && !pool.exit)
+			pthread_cond_wait(&pool.start, &pool.mutex);
+
+		if (pool.exit)
+			break;
+
+		generation = pool.generation;
+		pthread_mutex_unlock(&pool.mutex);
+
+		paint_bands(&pool.job);
+
+		pthread_mutex_lock(&pool.mutex);
+		if (--pool.remaining == 0)
+			pthread_cond_signal(&pool.done);
+	}
+
+	pthread_mutex_unlock(&pool.mutex);
+
+	return NULL;
+}
+
+bool
+render_pool_initialize(void)
+{
+	const char *string;
+	uint32_t num_threads = 1;
+	int ret;
+
+	pool.num_threads = 0;
+
+	if ((string = getenv(SWC_RENDER_THREADS_ENV)))
+		num_threads = MIN(strtoul(string, NULL, 10), MAX_THREADS + 1);
+
+	/* The main thread paints bands too, so only start the extra threads. */
+	if (num_threads <= 1)
+		return true;
+
+	pthread_mutex_init(&pool.mutex, NULL);
+	pthread_cond_init(&pool.start, NULL);
+	pthread_cond_init(&pool.done, NULL);
+	pool.generation = 0;
+	pool.exit = false;
+
+	for (; pool.num_threads < num_threads - 1; ++pool.num_threads) {
+		if ((ret = pthread_create(&pool.threads[pool.num_threads], NULL, &run_worker, NULL)) != 0) {
+			WARNING("Could not create render thread: %s\n", strerror(ret));
+			break;
+		}
+	}
+
+	DEBUG("Compositing with %u threads\n", pool.num_threads + 1);
+
+	return true;
+}
+
+void
+render_pool_finalize(void)
+{
+	uint32_t index;
+
+	if (pool.num_threads == 0)
+		return;
+
+	pthread_mutex_lock(&pool.mutex);
+	pool.exit = true;
+	pthread_cond_broadcast(&pool.start);
+	pthread_mutex_unlock(&pool.mutex);
+
+	for (index = 0; index < pool.num_threads; ++index)
+		pthread_join(pool.threads[index], NULL);
+
+	pthread_cond_destroy(&pool.done);
+	pthread_cond_destroy(&pool.start);
+	pthread_mutex_destroy(&pool.mutex);
+	pool.num_threads = 0;
+}
+
+bool
+render_pool_should_use(pixman_region32_t *damage)
+{
+	pixman_box32_t *boxes;
+	int num_boxes, index;
+	uint64_t area = 0;
+
+	if (pool.num_threads == 0)
+		return false;
+
+	boxes = pixman_region32_rectangles(damage, &num_boxes);
+	for (index = 0; index < num_boxes; ++index)
+		area += (uint64_t)(boxes[index].x2 - boxes[index].x1) * (boxes[index].y2 - boxes[index].y1);
+
+	return area >= MIN_PARALLEL_AREA;
+}
+
+static void
+unmap_buffers(struct wld_buffer *target, struct wl_array *ops, struct render_op *mapped_end)
+{
+	struct render_op *op;
+
+	for (op = ops->data; op < mapped_end; ++op) {
+		if (op->buffer)
+			wld_unmap(op->buffer);
+	}
+
+	wld_unmap(target);
+}
+
+bool
+render_pool_map(struct wld_buffer *target, struct wl_array *ops)
+{
+	struct render_op *op;
+
+	if (!format_to_pixman(target->format) || !wld_map(target))
+		return false;
+
+	wl_array_for_each (op, ops) {
+		if (op->buffer && (!format_to_pixman(op->buffer->format) || !wld_map(op->buffer))) {
+			unmap_buffers(target, ops, op);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void
+render_pool_unmap(struct wld_buffer *target, struct wl_array *ops)
+{
+	struct render_op *op;
+
+	wl_array_for_each (op, ops) {
+		if (op->buffer)
+			wld_unmap(op->buffer);
+	}
+
+	wld_unmap(target);
+}
+
+void
+render_pool_paint(struct wld_buffer *target, struct wl_array *ops)
+{
+	struct render_op *op;
+	pixman_region32_t damage;
+	pixman_box32_t *extents;
+	uint32_t num_bands = pool.num_threads + 1;
+
+	/* Only split the part of the target that is actually painted. */
+	pixman_region32_init(&damage);
+	wl_array_for_each (op, ops)
+		pixman_region32_union(&damage, &damage, &op->region);
+	extents = pixman_region32_extents(&damage);
+
+	pool.job.target_buffer = target;
+	pool.job.ops = ops;
+	pool.job.y = extents->y1;
+	pool.job.band_height = (extents->y2 - extents->y1 + num_bands - 1) / num_bands;
+	pool.job.num_bands = pool.job.band_height > 0 ? num_bands : 0;
+	atomic_store(&pool.next_band, 0);
+	pixman_region32_fini(&damage);
+
+	if (pool.num_threads > 0) {
+		pthread_mutex_lock(&pool.mutex);
+		pool.remaining = pool.num_threads;
+		++pool.generation;
+		pthread_cond_broadcast(&pool.start);
+		pthread_mutex_unlock(&pool.mutex);
+	}
+
+	paint_bands(&pool.job);
+
+	if (pool.num_threads > 0) {
+		pthread_mutex_lock(&pool.mutex);
+		while (pool.remaining > 0)
+			pthread_cond_wait(&pool.done, &pool.mutex);
+		pthread_mutex_unlock(&pool.mutex);
+	}
+}
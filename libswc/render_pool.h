@@ -0,0 +1,88 @@
+/* swc: libswc/render_pool.h
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SWC_RENDER_POOL_H
+#define SWC_RENDER_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pixman.h>
+
+#define SWC_RENDER_THREADS_ENV "SWC_RENDER_THREADS"
+
+struct wl_array;
+struct wld_buffer;
+
+/**
+ * A render operation paints a region of the target either with the contents of
+ * a buffer or with a solid color.
+ */
+struct render_op {
+	/* The region to paint, in target coordinates. */
+	pixman_region32_t region;
+
+	/* The buffer to copy from, or NULL to fill the region with color. */
+	struct wld_buffer *buffer;
+
+	/* The position of the buffer in target coordinates. */
+	int32_t x, y;
+
+	uint32_t color;
+};
+
+/**
+ * The render pool composites with pixman on several threads, each painting a
+ * horizontal band of the target. It is only used with software rendering, and
+ * the number of threads is taken from the SWC_RENDER_THREADS environment
+ * variable (by default, the pool is disabled).
+ */
+bool render_pool_initialize(void);
+void render_pool_finalize(void);
+
+/**
+ * Returns whether painting the specified damage is worth splitting between
+ * threads.
+ */
+bool render_pool_should_use(pixman_region32_t *damage);
+
+/**
+ * Maps the target and the buffers of the render operations. Returns false,
+ * with nothing mapped, if any of them could not be used by the pool.
+ *
+ * Mapping is not thread-safe, so this and render_pool_unmap must be called
+ * from the main thread.
+ */
+bool render_pool_map(struct wld_buffer *target, struct wl_array *ops);
+void render_pool_unmap(struct wld_buffer *target, struct wl_array *ops);
+
+/**
+ * Performs the render operations (struct render_op) in order, splitting the
+ * target into bands that are painted in parallel. The buffers must have been
+ * mapped with render_pool_map.
+ *
+ * This may be called from any one thread at a time, and paints serially if
+ * the pool has no threads.
+ */
+void render_pool_paint(struct wld_buffer *target, struct wl_array *ops);
+
+#endif
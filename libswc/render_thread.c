@@ -0,0 +1,252 @@
+/* swc: libswc/render_thread.c
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "render_thread.h"
+#include "internal.h"
+#include "render_pool.h"
+#include "util.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <wayland-server.h>
+
+static struct {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t submitted, finished;
+	bool exit;
+
+	/* Jobs waiting to be painted, and jobs waiting to be completed on the
+	 * main thread. */
+	struct wl_list queue, complete;
+	uint32_t busy;
+
+	int fd;
+	struct wl_event_source *source;
+} thread;
+
+static void
+copy_buffer(struct render_job *job)
+{
+	struct render_op op = { .region = job->copy_region, .buffer = job->buffer };
+	struct wl_array ops = { .size = sizeof(op), .alloc = sizeof(op), .data = &op };
+
+	render_pool_paint(job->copy_buffer, &ops);
+}
+
+/* Maps the buffers of a job on the main thread, so that the render thread only
+ * uses their mappings. */
+static bool
+map_job(struct render_job *job)
+{
+	struct wl_array no_ops = { 0 };
+
+	if (!render_pool_map(job->buffer, &job->ops))
+		return false;
+
+	/* The source of the copy is job->buffer, which is already mapped. */
+	if (job->copy_buffer && !render_pool_map(job->copy_buffer, &no_ops)) {
+		render_pool_unmap(job->buffer, &job->ops);
+		return false;
+	}
+
+	return true;
+}
+
+static void
+unmap_job(struct render_job *job)
+{
+	struct wl_array no_ops = { 0 };
+
+	if (job->copy_buffer)
+		render_pool_unmap(job->copy_buffer, &no_ops);
+	render_pool_unmap(job->buffer, &job->ops);
+}
+
+static void *
+run(void *data)
+{
+	struct render_job *job;
+	uint64_t value = 1;
+
+	pthread_mutex_lock(&thread.mutex);
+
+	for (;;) {
+		while (wl_list_empty(&thread.queue) && !thread.exit)
+			pthread_cond_wait(&thread.submitted, &thread.mutex);
+
+		if (wl_list_empty(&thread.queue))
+			break;
+
+		job = wl_container_of(thread.queue.prev, job, link);
+		wl_list_remove(&job->link);
+		pthread_mutex_unlock(&thread.mutex);
+
+		if (job->mapped) {
+			render_pool_paint(job->buffer, &job->ops);
+			if (job->copy_buffer)
+				copy_buffer(job);
+		}
+
+		pthread_mutex_lock(&thread.mutex);
+		wl_list_insert(&thread.complete, &job->link);
+		--thread.busy;
+		pthread_cond_signal(&thread.finished);
+
+		if (write(thread.fd, &value, sizeof(value)) != sizeof(value))
+			WARNING("Could not signal render completion: %s\n", strerror(errno));
+	}
+
+	pthread_mutex_unlock(&thread.mutex);
+
+	return NULL;
+}
+
+static void
+complete_jobs(void)
+{
+	struct render_job *job;
+	struct wl_list complete;
+
+	wl_list_init(&complete);
+	pthread_mutex_lock(&thread.mutex);
+	wl_list_insert_list(&complete, &thread.complete);
+	wl_list_init(&thread.complete);
+	pthread_mutex_unlock(&thread.mutex);
+
+	/* Jobs are completed in the order they were submitted. */
+	while (!wl_list_empty(&complete)) {
+		job = wl_container_of(complete.prev, job, link);
+		wl_list_remove(&job->link);
+		if (job->mapped)
+			unmap_job(job);
+		job->done(job);
+	}
+}
+
+static int
+handle_data(int fd, uint32_t mask, void *data)
+{
+	uint64_t value;
+
+	if (read(fd, &value, sizeof(value)) != sizeof(value))
+		return 0;
+
+	complete_jobs();
+	return 0;
+}
+
+bool
+render_thread_initialize(void)
+{
+	int ret;
+
+	if (!getenv(SWC_RENDER_THREAD_ENV))
+		goto error0;
+
+	thread.fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+	if (thread.fd == -1) {
+		WARNING("Could not create render thread eventfd: %s\n", strerror(errno));
+		goto error0;
+	}
+
+	thread.source = wl_event_loop_add_fd(swc.event_loop, thread.fd, WL_EVENT_READABLE, &handle_data, NULL);
+
+	if (!thread.source) {
+		WARNING("Could not create render thread event source\n");
+		goto error1;
+	}
+
+	pthread_mutex_init(&thread.mutex, NULL);
+	pthread_cond_init(&thread.submitted, NULL);
+	pthread_cond_init(&thread.finished, NULL);
+	wl_list_init(&thread.queue);
+	wl_list_init(&thread.complete);
+	thread.busy = 0;
+	thread.exit = false;
+
+	if ((ret = pthread_create(&thread.thread, NULL, &run, NULL)) != 0) {
+		WARNING("Could not create render thread: %s\n", strerror(ret));
+		goto error2;
+	}
+
+	return true;
+
+error2:
+	pthread_cond_destroy(&thread.finished);
+	pthread_cond_destroy(&thread.submitted);
+	pthread_mutex_destroy(&thread.mutex);
+	wl_event_source_remove(thread.source);
+error1:
+	close(thread.fd);
+error0:
+	return false;
+}
+
+void
+render_thread_finalize(void)
+{
+	pthread_mutex_lock(&thread.mutex);
+	thread.exit = true;
+	pthread_cond_signal(&thread.submitted);
+	pthread_mutex_unlock(&thread.mutex);
+
+	/* The thread paints any remaining jobs before exiting. */
+	pthread_join(thread.thread, NULL);
+	complete_jobs();
+
+	pthread_cond_destroy(&thread.finished);
+	pthread_cond_destroy(&thread.submitted);
+	pthread_mutex_destroy(&thread.mutex);
+	wl_event_source_remove(thread.source);
+	close(thread.fd);
+}
+
+void
+render_thread_submit(struct render_job *job)
+{
+	job->mapped = map_job(job);
+
+	pthread_mutex_lock(&thread.mutex);
+	wl_list_insert(&thread.queue, &job->link);
+	++thread.busy;
+	pthread_cond_signal(&thread.submitted);
+	pthread_mutex_unlock(&thread.mutex);
+}
+
+void
+render_thread_flush(void)
+{
+	pthread_mutex_lock(&thread.mutex);
+	while (thread.busy > 0)
+		pthread_cond_wait(&thread.finished, &thread.mutex);
+	pthread_mutex_unlock(&thread.mutex);
+
+	complete_jobs();
+}
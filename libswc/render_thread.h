@@ -0,0 +1,77 @@
+/* swc: libswc/render_thread.h
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SWC_RENDER_THREAD_H
+#define SWC_RENDER_THREAD_H
+
+#include <stdbool.h>
+#include <pixman.h>
+#include <wayland-util.h>
+
+#define SWC_RENDER_THREAD_ENV "SWC_RENDER_THREAD"
+
+struct wld_buffer;
+
+/**
+ * A render job paints a list of render operations (struct render_op) into a
+ * buffer on the render thread. Once it has finished, done is called from the
+ * main event loop.
+ */
+struct render_job {
+	struct wld_buffer *buffer;
+	struct wl_array ops;
+
+	/* If not NULL, copy_region of buffer is copied into this buffer after the
+	 * operations are painted. */
+	struct wld_buffer *copy_buffer;
+	pixman_region32_t copy_region;
+
+	/* Whether the buffers were mapped when the job was submitted. If not, the
+	 * operations are not painted, and must be painted on the main thread
+	 * instead. */
+	bool mapped;
+
+	void (*done)(struct render_job *job);
+	struct wl_list link;
+};
+
+/**
+ * The render thread composites with pixman while the main thread continues to
+ * dispatch client requests and input events. It is only used with software
+ * rendering, since wld renderers may not be used from other threads, and only
+ * if the SWC_RENDER_THREAD environment variable is set.
+ *
+ * The buffers of a job are mapped and unmapped on the main thread, when it is
+ * submitted and completed, so the render thread only touches their contents.
+ */
+bool render_thread_initialize(void);
+void render_thread_finalize(void);
+
+void render_thread_submit(struct render_job *job);
+
+/**
+ * Waits for every submitted job to finish, and calls their done functions.
+ */
+void render_thread_flush(void);
+
+#endif
@@ -22,12 +22,16 @@
  */
 
 #include "screen.h"
+#include "compositor.h"
 #include "drm.h"
 #include "event.h"
+#include "headless.h"
 #include "internal.h"
 #include "mode.h"
 #include "output.h"
+#include "output_power.h"
 #include "pointer.h"
+#include "seat.h"
 #include "util.h"
 
 #include <stdlib.h>
@@ -54,12 +58,155 @@ swc_screen_set_handler(struct swc_screen *base, const struct swc_screen_handler
 	screen->handler_data = data;
 }
 
+EXPORT void
+swc_screen_set_tearing(struct swc_screen *base, bool tearing)
+{
+	INTERNAL(base)->tearing = tearing;
+}
+
+EXPORT void
+swc_screen_set_adaptive_sync(struct swc_screen *base, bool enabled)
+{
+	primary_plane_set_vrr(&INTERNAL(base)->planes.primary, enabled);
+}
+
+EXPORT void
+swc_screen_set_queue_depth(struct swc_screen *base, uint32_t depth)
+{
+	INTERNAL(base)->queue_depth = MAX(MIN(depth, 2), 1);
+}
+
+EXPORT bool
+swc_screen_set_power(struct swc_screen *base, bool on)
+{
+	return screen_set_power(INTERNAL(base), on);
+}
+
+/**
+ * Returns the output whose modes the screen uses.
+ */
+static struct output *
+main_output(struct screen *screen)
+{
+	struct output *output;
+
+	return wl_container_of(screen->outputs.next, output, link);
+}
+
+EXPORT bool
+swc_screen_get_mode(struct swc_screen *base, uint32_t index, struct swc_mode *swc_mode)
+{
+	struct screen *screen = INTERNAL(base);
+	struct output *output = main_output(screen);
+	struct mode *mode;
+
+	if (index >= output->modes.size / sizeof(*mode))
+		return false;
+
+	mode = (struct mode *)output->modes.data + index;
+	swc_mode->width = mode->width;
+	swc_mode->height = mode->height;
+	swc_mode->refresh = mode->refresh;
+	swc_mode->preferred = mode->preferred;
+	swc_mode->current = mode_equal(mode, &screen->planes.primary.mode);
+
+	return true;
+}
+
+static struct mode *
+find_mode(struct output *output, const struct swc_mode *swc_mode)
+{
+	struct mode *mode;
+
+	wl_array_for_each (mode, &output->modes) {
+		if (mode->width == swc_mode->width && mode->height == swc_mode->height && mode->refresh == swc_mode->refresh)
+			return mode;
+	}
+
+	return NULL;
+}
+
+static void
+update_pointer_region(void)
+{
+	pixman_region32_t region;
+
+	pixman_region32_init(&region);
+	screens_get_region(&region);
+	pointer_set_region(swc.seat->pointer, &region);
+	pixman_region32_fini(&region);
+}
+
+EXPORT bool
+swc_screen_set_mode(struct swc_screen *base, const struct swc_mode *swc_mode)
+{
+	struct screen *screen = INTERNAL(base);
+	struct output *output = main_output(screen);
+	struct primary_plane *plane = &screen->planes.primary;
+	struct screen *other;
+	struct output *other_output;
+	struct mode *mode;
+	int32_t right, dx;
+
+	if (!(mode = find_mode(output, swc_mode))) {
+		ERROR("Screen has no %ux%u mode at %u mHz\n", swc_mode->width, swc_mode->height, swc_mode->refresh);
+		return false;
+	}
+
+	if (mode_equal(mode, &plane->mode))
+		return true;
+
+	if (!primary_plane_set_mode(plane, mode))
+		return false;
+
+	/* The screen geometry must be up to date before the compositor sees the
+	 * plane resize, since it uses it to find the screens of each view. */
+	if (mode->width != base->geometry.width || mode->height != base->geometry.height) {
+		right = base->geometry.x + base->geometry.width;
+		dx = (int32_t)mode->width - (int32_t)base->geometry.width;
+		base->geometry.width = mode->width;
+		base->geometry.height = mode->height;
+
+		/* Screens are placed side by side, so the ones to the right of this
+		 * screen move with its right edge. */
+		wl_list_for_each (other, &swc.screens, link) {
+			if (other->base.geometry.x >= right)
+				other->base.geometry.x += dx;
+		}
+
+		wl_list_for_each (other, &swc.screens, link) {
+			if (other->base.geometry.x != other->planes.primary.view.geometry.x)
+				view_move(&other->planes.primary.view, other->base.geometry.x, other->base.geometry.y);
+		}
+		view_set_size(&plane->view, mode->width, mode->height);
+		update_pointer_region();
+
+		if (screen->handler->geometry_changed)
+			screen->handler->geometry_changed(screen->handler_data);
+		screen_update_usable_geometry(screen);
+
+		wl_list_for_each (other, &swc.screens, link) {
+			if (other == screen || other->base.geometry.x < right + dx)
+				continue;
+			if (other->handler->geometry_changed)
+				other->handler->geometry_changed(other->handler_data);
+			screen_update_usable_geometry(other);
+			wl_list_for_each (other_output, &other->outputs, link)
+				output_send_geometry(other_output);
+		}
+	}
+
+	output_send_mode(output);
+
+	return true;
+}
+
 bool
 screens_initialize(void)
 {
 	wl_list_init(&swc.screens);
 
-	if (!drm_create_screens(&swc.screens))
+	if (!(swc.headless ? headless_create_screens(&swc.screens) : drm_create_screens(&swc.screens)))
 		return false;
 
 	if (wl_list_empty(&swc.screens))
@@ -122,12 +269,14 @@ screen_new(uint32_t crtc, struct output *output)
 		goto error2;
 	}
 
-	if (!cursor_plane_initialize(&screen->planes.cursor, crtc, &screen->base.geometry)) {
+	if (!cursor_plane_initialize(&screen->planes.cursor, crtc, &screen->planes.primary, &screen->base.geometry)) {
 		ERROR("Failed to initialize cursor plane\n");
 		goto error3;
 	}
 
 	screen->handler = &null_handler;
+	screen->tearing = false;
+	screen->queue_depth = 1;
 	wl_signal_init(&screen->destroy_signal);
 	wl_list_init(&screen->resources);
 	wl_list_init(&screen->outputs);
@@ -204,6 +353,36 @@ screen_update_usable_geometry(struct screen *screen)
 	}
 }
 
+bool
+screen_set_power(struct screen *screen, bool on)
+{
+	struct output *output;
+
+	if (screen->planes.primary.off == !on)
+		return true;
+
+	if (!compositor_set_screen_power(screen, on))
+		return false;
+
+	wl_list_for_each (output, &screen->outputs, link)
+		output_power_send_mode(output);
+
+	return true;
+}
+
+void
+screens_get_region(pixman_region32_t *region)
+{
+	struct screen *screen;
+	struct swc_rectangle *geom;
+
+	pixman_region32_clear(region);
+	wl_list_for_each (screen, &swc.screens, link) {
+		geom = &screen->base.geometry;
+		pixman_region32_union_rect(region, region, geom->x, geom->y, geom->width, geom->height);
+	}
+}
+
 bool
 handle_motion(struct pointer_handler *handler, uint32_t time, wl_fixed_t fx, wl_fixed_t fy)
 {
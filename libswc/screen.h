@@ -49,7 +49,13 @@ struct screen {
 	void *handler_data;
 
 	struct wl_signal destroy_signal;
-	uint8_t id;
+	uint32_t id;
+
+	/* Whether the window manager allows new frames to be displayed without
+	 * waiting for the vertical blank. */
+	bool tearing;
+	/* The number of frames that may be waiting to be displayed. */
+	uint32_t queue_depth;
 
 	struct {
 		struct primary_plane primary;
@@ -70,12 +76,17 @@ void screens_finalize(void);
 struct screen *screen_new(uint32_t crtc, struct output *output);
 void screen_destroy(struct screen *screen);
 
-static inline uint32_t
-screen_mask(struct screen *screen)
-{
-	return 1 << screen->id;
-}
-
 void screen_update_usable_geometry(struct screen *screen);
 
+/**
+ * Turns the screen off or back on, and tells the clients controlling the
+ * power of its outputs.
+ */
+bool screen_set_power(struct screen *screen, bool on);
+
+/**
+ * Sets region to the area covered by all the screens.
+ */
+void screens_get_region(struct pixman_region32 *region);
+
 #endif
@@ -0,0 +1,186 @@
+/* swc: libswc/screen_set.c
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "screen_set.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void
+screen_set_initialize(struct screen_set *set)
+{
+	set->word = 0;
+	set->words = NULL;
+	set->num_words = 0;
+}
+
+void
+screen_set_finalize(struct screen_set *set)
+{
+	free(set->words);
+}
+
+/**
+ * Makes sure that the set has at least the specified number of additional
+ * words. New words are empty.
+ */
+static bool
+reserve(struct screen_set *set, uint32_t num_words)
+{
+	uint64_t *words;
+
+	if (num_words <= set->num_words)
+		return true;
+
+	if (!(words = realloc(set->words, num_words * sizeof(words[0]))))
+		return false;
+
+	memset(&words[set->num_words], 0, (num_words - set->num_words) * sizeof(words[0]));
+	set->words = words;
+	set->num_words = num_words;
+
+	return true;
+}
+
+bool
+screen_set_add(struct screen_set *set, uint32_t id)
+{
+	if (id < 64) {
+		set->word |= 1ull << id;
+		return true;
+	}
+
+	id -= 64;
+	if (!reserve(set, id / 64 + 1))
+		return false;
+	set->words[id / 64] |= 1ull << id % 64;
+
+	return true;
+}
+
+void
+screen_set_remove(struct screen_set *set, uint32_t id)
+{
+	if (id < 64) {
+		set->word &= ~(1ull << id);
+		return;
+	}
+
+	id -= 64;
+	if (id / 64 < set->num_words)
+		set->words[id / 64] &= ~(1ull << id % 64);
+}
+
+void
+screen_set_clear(struct screen_set *set)
+{
+	set->word = 0;
+	if (set->num_words > 0)
+		memset(set->words, 0, set->num_words * sizeof(set->words[0]));
+}
+
+bool
+screen_set_copy(struct screen_set *set, const struct screen_set *other)
+{
+	screen_set_clear(set);
+	return screen_set_union(set, other);
+}
+
+bool
+screen_set_union(struct screen_set *set, const struct screen_set *other)
+{
+	uint32_t i;
+
+	set->word |= other->word;
+	if (other->num_words == 0)
+		return true;
+
+	if (!reserve(set, other->num_words))
+		return false;
+	for (i = 0; i < other->num_words; ++i)
+		set->words[i] |= other->words[i];
+
+	return true;
+}
+
+void
+screen_set_subtract(struct screen_set *set, const struct screen_set *other)
+{
+	uint32_t i, num_words = MIN(set->num_words, other->num_words);
+
+	set->word &= ~other->word;
+	for (i = 0; i < num_words; ++i)
+		set->words[i] &= ~other->words[i];
+}
+
+bool
+screen_set_is_empty(const struct screen_set *set)
+{
+	uint32_t i;
+
+	if (set->word)
+		return false;
+	for (i = 0; i < set->num_words; ++i) {
+		if (set->words[i])
+			return false;
+	}
+
+	return true;
+}
+
+bool
+screen_set_equal(const struct screen_set *set1, const struct screen_set *set2)
+{
+	return screen_set_contains_set(set1, set2) && screen_set_contains_set(set2, set1);
+}
+
+bool
+screen_set_intersects(const struct screen_set *set1, const struct screen_set *set2)
+{
+	uint32_t i, num_words = MIN(set1->num_words, set2->num_words);
+
+	if (set1->word & set2->word)
+		return true;
+	for (i = 0; i < num_words; ++i) {
+		if (set1->words[i] & set2->words[i])
+			return true;
+	}
+
+	return false;
+}
+
+bool
+screen_set_contains_set(const struct screen_set *set, const struct screen_set *other)
+{
+	uint32_t i;
+
+	if (other->word & ~set->word)
+		return false;
+	for (i = 0; i < other->num_words; ++i) {
+		if (other->words[i] & ~(i < set->num_words ? set->words[i] : 0))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,79 @@
+/* swc: libswc/screen_set.h
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SWC_SCREEN_SET_H
+#define SWC_SCREEN_SET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * A set of screens, indexed by their IDs. The first 64 screens are stored in
+ * a single word, so for most setups, the operations on sets are a few
+ * instructions and never allocate. Screens with higher IDs are stored in
+ * additional words, which are allocated as needed.
+ */
+struct screen_set {
+	uint64_t word;
+	uint64_t *words;
+	uint32_t num_words;
+};
+
+void screen_set_initialize(struct screen_set *set);
+void screen_set_finalize(struct screen_set *set);
+
+/**
+ * Adds a screen to the set. Returns false if the set could not be grown to
+ * hold it.
+ */
+bool screen_set_add(struct screen_set *set, uint32_t id);
+void screen_set_remove(struct screen_set *set, uint32_t id);
+void screen_set_clear(struct screen_set *set);
+
+/**
+ * Operations on two sets, storing the result in the first one. Returns false
+ * if the set could not be grown to hold the result.
+ */
+bool screen_set_copy(struct screen_set *set, const struct screen_set *other);
+bool screen_set_union(struct screen_set *set, const struct screen_set *other);
+void screen_set_subtract(struct screen_set *set, const struct screen_set *other);
+
+bool screen_set_is_empty(const struct screen_set *set);
+bool screen_set_equal(const struct screen_set *set1, const struct screen_set *set2);
+bool screen_set_intersects(const struct screen_set *set1, const struct screen_set *set2);
+
+/**
+ * Returns whether every screen in the second set is in the first.
+ */
+bool screen_set_contains_set(const struct screen_set *set, const struct screen_set *other);
+
+static inline bool
+screen_set_contains(const struct screen_set *set, uint32_t id)
+{
+	if (id < 64)
+		return set->word & (1ull << id);
+	id -= 64;
+	return id / 64 < set->num_words && set->words[id / 64] & (1ull << id % 64);
+}
+
+#endif
@@ -117,11 +117,12 @@ handle_swc_event(struct wl_listener *listener, void *data)
 
 	switch (ev->type) {
 	case SWC_EVENT_DEACTIVATED:
-		libinput_suspend(seat.libinput);
+		if (seat.libinput)
+			libinput_suspend(seat.libinput);
 		keyboard_reset(&seat.keyboard);
 		break;
 	case SWC_EVENT_ACTIVATED:
-		if (libinput_resume(seat.libinput) != 0)
+		if (seat.libinput && libinput_resume(seat.libinput) != 0)
 			WARNING("Failed to resume libinput context\n");
 		break;
 	}
@@ -405,7 +406,9 @@ seat_initialize(const char *seat_name)
 		goto error4;
 	}
 
-	if (!initialize_libinput(seat.name))
+	/* Headless sessions have no input devices of their own. */
+	seat.libinput = NULL;
+	if (!swc.headless && !initialize_libinput(seat.name))
 		goto error5;
 
 	return true;
@@ -427,11 +430,13 @@ error0:
 void
 seat_finalize(void)
 {
-	wl_event_source_remove(seat.libinput_source);
-	libinput_unref(seat.libinput);
+	if (seat.libinput) {
+		wl_event_source_remove(seat.libinput_source);
+		libinput_unref(seat.libinput);
 #ifdef ENABLE_LIBUDEV
-	udev_unref(seat.udev);
+		udev_unref(seat.udev);
 #endif
+	}
 
 	pointer_finalize(&seat.pointer);
 	keyboard_finalize(&seat.keyboard);
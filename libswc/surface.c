@@ -22,9 +22,12 @@
  */
 
 #include "surface.h"
+#include "compositor.h"
+#include "damage.h"
 #include "event.h"
 #include "internal.h"
 #include "output.h"
+#include "presentation.h"
 #include "region.h"
 #include "screen.h"
 #include "util.h"
@@ -35,6 +38,18 @@
 #include <stdio.h>
 #include <wld/wld.h>
 
+struct held_buffer {
+	struct wld_buffer *buffer;
+	struct wl_resource *resource;
+	struct wl_listener destroy_listener;
+	struct wl_list link;
+};
+
+/* The client buffers that were replaced while the compositor was still using
+ * them. They are released once it no longer does, even if their surfaces have
+ * been destroyed in the meantime. */
+static struct wl_list held_buffers = { &held_buffers, &held_buffers };
+
 /**
  * Removes a buffer from a surface state.
  */
@@ -58,6 +73,8 @@ state_initialize(struct surface_state *state)
 	pixman_region32_init_with_extents(&state->input, &infinite_extents);
 
 	wl_list_init(&state->frame_callbacks);
+	wl_list_init(&state->feedbacks);
+	state->tearing = false;
 }
 
 static void
@@ -75,6 +92,8 @@ state_finalize(struct surface_state *state)
 	/* Remove all leftover callbacks. */
 	wl_list_for_each_safe (resource, tmp, &state->frame_callbacks, link)
 		wl_resource_destroy(resource);
+
+	presentation_discard(&state->feedbacks);
 }
 
 /**
@@ -96,12 +115,61 @@ state_set_buffer(struct surface_state *state, struct wl_resource *resource)
 	state->buffer_resource = resource;
 }
 
+static void
+handle_held_buffer_destroy(struct wl_listener *listener, void *data)
+{
+	struct held_buffer *held = wl_container_of(listener, held, destroy_listener);
+
+	wl_list_remove(&held->link);
+	free(held);
+}
+
+/**
+ * Releases a buffer that is no longer attached to the surface, or if the
+ * compositor is still using it, for example on a hardware plane, holds onto it
+ * until it no longer does.
+ */
+static void
+release_buffer(struct wld_buffer *buffer, struct wl_resource *resource)
+{
+	struct held_buffer *held;
+
+	if (compositor_buffer_in_use(buffer) && (held = malloc(sizeof(*held)))) {
+		held->buffer = buffer;
+		held->resource = resource;
+		held->destroy_listener.notify = &handle_held_buffer_destroy;
+		wl_resource_add_destroy_listener(resource, &held->destroy_listener);
+		wl_list_insert(&held_buffers, &held->link);
+		return;
+	}
+
+	wl_buffer_send_release(resource);
+}
+
+void
+surface_release_held_buffer(struct wld_buffer *buffer)
+{
+	struct held_buffer *held, *tmp;
+
+	wl_list_for_each_safe (held, tmp, &held_buffers, link) {
+		if (held->buffer != buffer)
+			continue;
+		wl_buffer_send_release(held->resource);
+		wl_list_remove(&held->destroy_listener.link);
+		wl_list_remove(&held->link);
+		free(held);
+	}
+}
+
 static void
 handle_frame(struct view_handler *handler, uint32_t time)
 {
 	struct surface *surface = wl_container_of(handler, surface, view_handler);
 	struct wl_resource *resource, *tmp;
 
+	if (!wl_list_empty(&surface->state.frame_callbacks))
+		surface->frame_time = get_monotonic_time();
+
 	wl_list_for_each_safe (resource, tmp, &surface->state.frame_callbacks, link) {
 		wl_callback_send_done(resource, time);
 		wl_resource_destroy(resource);
@@ -111,7 +179,7 @@ handle_frame(struct view_handler *handler, uint32_t time)
 }
 
 static void
-handle_screens(struct view_handler *handler, uint32_t entered, uint32_t left)
+handle_screens(struct view_handler *handler, const struct screen_set *entered, const struct screen_set *left)
 {
 	struct surface *surface = wl_container_of(handler, surface, view_handler);
 	struct screen *screen;
@@ -122,16 +190,16 @@ handle_screens(struct view_handler *handler, uint32_t entered, uint32_t left)
 	client = wl_resource_get_client(surface->resource);
 
 	wl_list_for_each (screen, &swc.screens, link) {
-		if (!((entered | left) & screen_mask(screen)))
+		if (!screen_set_contains(entered, screen->id) && !screen_set_contains(left, screen->id))
 			continue;
 
 		wl_list_for_each (output, &screen->outputs, link) {
 			resource = wl_resource_find_for_client(&output->resources, client);
 
 			if (resource) {
-				if (entered & screen_mask(screen))
+				if (screen_set_contains(entered, screen->id))
 					wl_surface_send_enter(surface->resource, resource);
-				else if (left & screen_mask(screen))
+				else if (screen_set_contains(left, screen->id))
 					wl_surface_send_leave(surface->resource, resource);
 			}
 		}
@@ -169,6 +237,7 @@ damage(struct wl_client *client, struct wl_resource *resource, int32_t x, int32_
 
 	surface->pending.commit |= SURFACE_COMMIT_DAMAGE;
 	pixman_region32_union_rect(&surface->pending.state.damage, &surface->pending.state.damage, x, y, width, height);
+	damage_limit_pending(&surface->pending.state.damage);
 }
 
 static void
@@ -219,6 +288,27 @@ trim_region(pixman_region32_t *region, struct wld_buffer *buffer)
 	pixman_region32_intersect_rect(region, region, 0, 0, buffer ? buffer->width : 0, buffer ? buffer->height : 0);
 }
 
+/* Latencies longer than this are probably from clients that only draw in
+ * response to input, and are not used in the estimate. */
+#define MAX_COMMIT_LATENCY 100000000
+
+static void
+update_commit_latency(struct surface *surface)
+{
+	uint64_t latency = get_monotonic_time() - surface->frame_time;
+
+	surface->frame_time = 0;
+	if (latency > MAX_COMMIT_LATENCY)
+		return;
+
+	/* Follow increases immediately so that frames aren't sent too late, but
+	 * decreases slowly. */
+	if (latency > surface->commit_latency)
+		surface->commit_latency = latency;
+	else
+		surface->commit_latency = (surface->commit_latency * 7 + latency) / 8;
+}
+
 static void
 commit(struct wl_client *client, struct wl_resource *resource)
 {
@@ -227,8 +317,10 @@ commit(struct wl_client *client, struct wl_resource *resource)
 
 	/* Attach */
 	if (surface->pending.commit & SURFACE_COMMIT_ATTACH) {
+		if (surface->frame_time)
+			update_commit_latency(surface);
 		if (surface->state.buffer && surface->state.buffer != surface->pending.state.buffer)
-			wl_buffer_send_release(surface->state.buffer_resource);
+			release_buffer(surface->state.buffer, surface->state.buffer_resource);
 
 		state_set_buffer(&surface->state, surface->pending.state.buffer_resource);
 	}
@@ -238,6 +330,7 @@ commit(struct wl_client *client, struct wl_resource *resource)
 	/* Damage */
 	if (surface->pending.commit & SURFACE_COMMIT_DAMAGE) {
 		pixman_region32_union(&surface->state.damage, &surface->state.damage, &surface->pending.state.damage);
+		damage_limit_surface(&surface->state.damage);
 		pixman_region32_clear(&surface->pending.state.damage);
 	}
 
@@ -255,6 +348,16 @@ commit(struct wl_client *client, struct wl_resource *resource)
 		wl_list_init(&surface->pending.state.frame_callbacks);
 	}
 
+	/* Presentation feedback. The content that hasn't been displayed yet is
+	 * replaced by this commit. */
+	presentation_discard(&surface->state.feedbacks);
+	wl_list_insert_list(&surface->state.feedbacks, &surface->pending.state.feedbacks);
+	wl_list_init(&surface->pending.state.feedbacks);
+
+	/* Presentation hint */
+	if (surface->pending.commit & SURFACE_COMMIT_PRESENTATION_HINT)
+		surface->state.tearing = surface->pending.state.tearing;
+
 	trim_region(&surface->state.damage, buffer);
 	trim_region(&surface->state.opaque, buffer);
 
@@ -302,6 +405,10 @@ surface_destroy(struct wl_resource *resource)
 	if (surface->view)
 		wl_list_remove(&surface->view_handler.link);
 
+	/* The tearing-control object becomes inert. */
+	if (surface->tearing_control)
+		wl_resource_set_user_data(surface->tearing_control, NULL);
+
 	free(surface);
 }
 
@@ -324,6 +431,9 @@ surface_new(struct wl_client *client, uint32_t version, uint32_t id)
 	surface->pending.commit = 0;
 	surface->view = NULL;
 	surface->view_handler.impl = &view_handler_impl;
+	surface->frame_time = 0;
+	surface->commit_latency = 0;
+	surface->tearing_control = NULL;
 
 	state_initialize(&surface->state);
 	state_initialize(&surface->pending.state);
@@ -34,7 +34,8 @@ enum {
 	SURFACE_COMMIT_DAMAGE = (1 << 1),
 	SURFACE_COMMIT_OPAQUE = (1 << 2),
 	SURFACE_COMMIT_INPUT = (1 << 3),
-	SURFACE_COMMIT_FRAME = (1 << 4)
+	SURFACE_COMMIT_FRAME = (1 << 4),
+	SURFACE_COMMIT_PRESENTATION_HINT = (1 << 5)
 };
 
 struct surface_state {
@@ -52,6 +53,15 @@ struct surface_state {
 	pixman_region32_t input;
 
 	struct wl_list frame_callbacks;
+
+	/* The presentation feedback resources for the content of this state. Once
+	 * the content is in a frame on its way to the screen, they are moved to
+	 * the compositor. */
+	struct wl_list feedbacks;
+
+	/* Whether the client prefers its content to be displayed as soon as
+	 * possible, even if it tears, set with the tearing-control protocol. */
+	bool tearing;
 };
 
 struct surface {
@@ -67,9 +77,26 @@ struct surface {
 
 	struct view *view;
 	struct view_handler view_handler;
+
+	/* The time at which frame callbacks were last sent, in nanoseconds on the
+	 * monotonic clock, or 0 if the client has attached a buffer since. */
+	uint64_t frame_time;
+
+	/* An estimate of how long the client takes to attach a new buffer after
+	 * its frame callbacks are sent, in nanoseconds, or 0 if unknown. */
+	uint64_t commit_latency;
+
+	/* The tearing-control object of the surface, or NULL. */
+	struct wl_resource *tearing_control;
 };
 
 struct surface *surface_new(struct wl_client *client, uint32_t version, uint32_t id);
 void surface_set_view(struct surface *surface, struct view *view);
 
+/**
+ * Releases a client buffer that was replaced by a commit while the compositor
+ * was still using it, now that it no longer is.
+ */
+void surface_release_held_buffer(struct wld_buffer *buffer);
+
 #endif
@@ -27,16 +27,20 @@
 #include "data_device_manager.h"
 #include "drm.h"
 #include "event.h"
+#include "headless.h"
 #include "internal.h"
 #include "launch.h"
 #include "keyboard.h"
+#include "output_power.h"
 #include "panel_manager.h"
 #include "pointer.h"
+#include "presentation.h"
 #include "screen.h"
 #include "seat.h"
 #include "shell.h"
 #include "shm.h"
 #include "subcompositor.h"
+#include "tearing_control.h"
 #include "util.h"
 #include "window.h"
 #include "xdg_shell.h"
@@ -62,8 +66,6 @@ static void
 setup_compositor(void)
 {
 	pixman_region32_t pointer_region;
-	struct screen *screen;
-	struct swc_rectangle *geom;
 
 	wl_list_insert(&swc.seat->keyboard->handlers, &swc.bindings->keyboard_handler->link);
 	wl_list_insert(&swc.seat->pointer->handlers, &swc.bindings->pointer_handler->link);
@@ -73,12 +75,7 @@ setup_compositor(void)
 
 	/* Calculate pointer region */
 	pixman_region32_init(&pointer_region);
-
-	wl_list_for_each (screen, &swc.screens, link) {
-		geom = &screen->base.geometry;
-		pixman_region32_union_rect(&pointer_region, &pointer_region, geom->x, geom->y, geom->width, geom->height);
-	}
-
+	screens_get_region(&pointer_region);
 	pointer_set_region(swc.seat->pointer, &pointer_region);
 	pixman_region32_fini(&pointer_region);
 }
@@ -109,14 +106,15 @@ swc_initialize(struct wl_display *display, struct wl_event_loop *event_loop, con
 	swc.manager = manager;
 	const char *default_seat = "seat0";
 	wl_signal_init(&swc.event_signal);
+	swc.headless = getenv(SWC_HEADLESS_ENV) != NULL;
 
-	if (!launch_initialize()) {
+	if (!swc.headless && !launch_initialize()) {
 		ERROR("Could not connect to swc-launch\n");
 		goto error0;
 	}
 
-	if (!drm_initialize()) {
-		ERROR("Could not initialize DRM\n");
+	if (!(swc.headless ? headless_initialize() : drm_initialize())) {
+		ERROR("Could not initialize %s\n", swc.headless ? "headless backend" : "DRM");
 		goto error1;
 	}
 
@@ -170,10 +168,35 @@ swc_initialize(struct wl_display *display, struct wl_event_loop *event_loop, con
 		goto error11;
 	}
 
+	if (!presentation_initialize()) {
+		ERROR("Could not initialize presentation\n");
+		goto error12;
+	}
+
+	if (!tearing_control_initialize()) {
+		ERROR("Could not initialize tearing control\n");
+		goto error13;
+	}
+
+	if (!output_power_initialize()) {
+		ERROR("Could not initialize output power management\n");
+		goto error14;
+	}
+
 	setup_compositor();
 
+	/* Without swc-launch, there is nobody to tell us that we are active. */
+	if (swc.headless)
+		swc_activate();
+
 	return true;
 
+error14:
+	tearing_control_finalize();
+error13:
+	presentation_finalize();
+error12:
+	panel_manager_finalize();
 error11:
 	xdg_shell_finalize();
 error10:
@@ -193,9 +216,13 @@ error4:
 error3:
 	shm_finalize();
 error2:
-	drm_finalize();
+	if (swc.headless)
+		headless_finalize();
+	else
+		drm_finalize();
 error1:
-	launch_finalize();
+	if (!swc.headless)
+		launch_finalize();
 error0:
 	return false;
 }
@@ -203,6 +230,9 @@ error0:
 EXPORT void
 swc_finalize(void)
 {
+	output_power_finalize();
+	tearing_control_finalize();
+	presentation_finalize();
 	panel_manager_finalize();
 	shell_finalize();
 	seat_finalize();
@@ -211,6 +241,10 @@ swc_finalize(void)
 	screens_finalize();
 	bindings_finalize();
 	shm_finalize();
-	drm_finalize();
-	launch_finalize();
+	if (swc.headless) {
+		headless_finalize();
+	} else {
+		drm_finalize();
+		launch_finalize();
+	}
 }
@@ -90,6 +90,76 @@ struct swc_screen {
  */
 void swc_screen_set_handler(struct swc_screen *screen, const struct swc_screen_handler *handler, void *data);
 
+/**
+ * Set whether new frames may be displayed on this screen as soon as they are
+ * ready, rather than at the next vertical blank, at the cost of tearing.
+ *
+ * Clients can also ask for this for surfaces covering a screen with the
+ * tearing-control protocol. If the DRM device does not support asynchronous
+ * page flips, frames are still displayed at the vertical blank.
+ */
+void swc_screen_set_tearing(struct swc_screen *screen, bool tearing);
+
+/**
+ * Set whether this screen may use a variable refresh rate, if it supports one.
+ *
+ * New frames are then displayed as soon as they are ready, and when nothing
+ * changes, the screen refreshes at its lowest rate. Screens that don't
+ * support it keep their fixed refresh rate.
+ */
+void swc_screen_set_adaptive_sync(struct swc_screen *screen, bool enabled);
+
+/**
+ * Set the number of frames of this screen that may be waiting to be displayed.
+ *
+ * With a depth of 2, a new frame is composited while the previous one is
+ * still waiting for the vertical blank, and displayed at the one after. This
+ * keeps frames that take long to composite from delaying the next one, at
+ * the cost of up to a refresh period of latency. The default is 1, and
+ * larger depths are treated as 2.
+ */
+void swc_screen_set_queue_depth(struct swc_screen *screen, uint32_t depth);
+
+/**
+ * Turn this screen off to save power, or back on.
+ *
+ * While a screen is off, it is not repainted, and windows that are only on
+ * screens that are off are sent frame events at a low rate. Clients can also
+ * do this with the wlr-output-power-management protocol.
+ */
+bool swc_screen_set_power(struct swc_screen *screen, bool on);
+
+struct swc_mode {
+	uint32_t width, height;
+
+	/**
+	 * The refresh rate in mHz.
+	 */
+	uint32_t refresh;
+
+	bool preferred, current;
+};
+
+/**
+ * Get one of the modes supported by this screen.
+ *
+ * The modes are numbered from 0, so all of them can be listed by increasing
+ * the index until this returns false.
+ */
+bool swc_screen_get_mode(struct swc_screen *screen, uint32_t index, struct swc_mode *mode);
+
+/**
+ * Switch this screen to the supported mode with the size and refresh rate of
+ * the specified one.
+ *
+ * The mode is set along with the next frame, and frames are scheduled at its
+ * refresh rate from then on. If the size changes, the screens to the right of
+ * this one are moved so that they stay next to it, and the geometry_changed
+ * handler of each screen that changed is called. Returns false if the screen
+ * has no such mode.
+ */
+bool swc_screen_set_mode(struct swc_screen *screen, const struct swc_mode *mode);
+
 /* }}} */
 
 /* Windows {{{ */
@@ -237,6 +307,16 @@ void swc_window_set_geometry(struct swc_window *window, const struct swc_rectang
  */
 void swc_window_set_border(struct swc_window *window, uint32_t color, uint32_t width);
 
+/**
+ * Limit the rate of frame events sent to the window, in frames per second.
+ *
+ * This can be used to reduce the work done by clients in the background. A
+ * rate of 0 removes the limit. Independent of this limit, windows that are
+ * completely covered by other windows are limited to a low rate, and hidden
+ * windows receive frame events at 1 frame per second.
+ */
+void swc_window_set_frame_rate_limit(struct swc_window *window, uint32_t rate);
+
 /**
  * Begin an interactive move of the specified window.
  */
@@ -293,6 +373,66 @@ int swc_add_binding(enum swc_binding_type type, uint32_t modifiers, uint32_t val
 
 /* }}} */
 
+/* Damage {{{ */
+
+struct swc_damage_stats {
+	/* The number of times a damage region was simplified. */
+	uint64_t simplified;
+
+	/* The total number of rectangles in the simplified regions before and
+	 * after simplification. */
+	uint64_t boxes_before, boxes_after;
+
+	/* The total number of undamaged pixels added to the regions. */
+	uint64_t wasted_area;
+};
+
+/**
+ * Set the maximum number of rectangles in the damage of a surface and in the
+ * damage of a screen. Damage with more rectangles is simplified by merging
+ * nearby rectangles. A limit of 0 means no limit.
+ *
+ * The defaults are 32 for surfaces and 64 for screens.
+ */
+void swc_set_damage_limits(uint32_t surface_limit, uint32_t screen_limit);
+
+/**
+ * Get statistics about the damage simplified so far.
+ */
+void swc_get_damage_stats(struct swc_damage_stats *stats);
+
+/* }}} */
+
+/* Repainting {{{ */
+
+/**
+ * Set how long before the vertical blank of a screen to start repainting it,
+ * in microseconds. A longer window gives more time to composite, and a shorter
+ * one lets more client updates make it into the frame. If the window is
+ * longer than the refresh period, screens are repainted as soon as possible.
+ *
+ * The default is 7000 microseconds.
+ */
+void swc_set_repaint_window(uint32_t usec);
+
+struct swc_update_stats {
+	/* The number of updates that repainted at least one screen, and the total
+	 * time spent in them, in nanoseconds. */
+	uint64_t updates, update_time;
+
+	/* The number of screen repaints started by those updates, and the total
+	 * time spent starting them, in nanoseconds. With a render thread, this
+	 * does not include the composition itself. */
+	uint64_t screens, screen_time;
+};
+
+/**
+ * Get statistics about the updates performed so far.
+ */
+void swc_get_update_stats(struct swc_update_stats *stats);
+
+/* }}} */
+
 /**
  * This is a user-provided structure that swc will use to notify the display
  * server of new windows, screens and input devices.
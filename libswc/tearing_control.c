@@ -0,0 +1,134 @@
+/* swc: libswc/tearing_control.c
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tearing_control.h"
+#include "internal.h"
+#include "surface.h"
+#include "util.h"
+
+#include <wayland-server.h>
+#include "tearing-control-v1-server-protocol.h"
+
+static struct {
+	struct wl_global *global;
+} tearing_control;
+
+static void
+destroy(struct wl_client *client, struct wl_resource *resource)
+{
+	wl_resource_destroy(resource);
+}
+
+static void
+set_presentation_hint(struct wl_client *client, struct wl_resource *resource, uint32_t hint)
+{
+	struct surface *surface = wl_resource_get_user_data(resource);
+
+	if (!surface)
+		return;
+
+	surface->pending.commit |= SURFACE_COMMIT_PRESENTATION_HINT;
+	surface->pending.state.tearing = hint == WP_TEARING_CONTROL_V1_PRESENTATION_HINT_ASYNC;
+}
+
+static const struct wp_tearing_control_v1_interface tearing_control_implementation = {
+	.set_presentation_hint = set_presentation_hint,
+	.destroy = destroy,
+};
+
+static void
+tearing_control_destroy(struct wl_resource *resource)
+{
+	struct surface *surface = wl_resource_get_user_data(resource);
+
+	if (!surface)
+		return;
+
+	/* The surface goes back to the default hint on its next commit. */
+	surface->tearing_control = NULL;
+	surface->pending.commit |= SURFACE_COMMIT_PRESENTATION_HINT;
+	surface->pending.state.tearing = false;
+}
+
+static void
+get_tearing_control(struct wl_client *client, struct wl_resource *resource, uint32_t id, struct wl_resource *surface_resource)
+{
+	struct surface *surface = wl_resource_get_user_data(surface_resource);
+	struct wl_resource *tearing_control_resource;
+
+	if (surface->tearing_control) {
+		wl_resource_post_error(resource, WP_TEARING_CONTROL_MANAGER_V1_ERROR_TEARING_CONTROL_EXISTS,
+		                       "surface already has a tearing-control object");
+		return;
+	}
+
+	tearing_control_resource = wl_resource_create(client, &wp_tearing_control_v1_interface, 1, id);
+
+	if (!tearing_control_resource) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	wl_resource_set_implementation(tearing_control_resource, &tearing_control_implementation, surface, &tearing_control_destroy);
+	surface->tearing_control = tearing_control_resource;
+}
+
+static const struct wp_tearing_control_manager_v1_interface manager_implementation = {
+	.destroy = destroy,
+	.get_tearing_control = get_tearing_control,
+};
+
+static void
+bind_manager(struct wl_client *client, void *data, uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource;
+
+	if (version > 1)
+		version = 1;
+
+	resource = wl_resource_create(client, &wp_tearing_control_manager_v1_interface, version, id);
+
+	if (!resource) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	wl_resource_set_implementation(resource, &manager_implementation, NULL, NULL);
+}
+
+bool
+tearing_control_initialize(void)
+{
+	tearing_control.global = wl_global_create(swc.display, &wp_tearing_control_manager_v1_interface, 1, NULL, &bind_manager);
+
+	if (!tearing_control.global)
+		return false;
+
+	return true;
+}
+
+void
+tearing_control_finalize(void)
+{
+	wl_global_destroy(tearing_control.global);
+}
@@ -31,6 +31,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/param.h>
 #include <pixman.h>
 #include <wayland-util.h>
@@ -74,6 +75,19 @@ get_time(void)
 	return timeval.tv_sec * 1000 + timeval.tv_usec / 1000;
 }
 
+/**
+ * Returns the time in nanoseconds on the monotonic clock, which is the one
+ * used for DRM event timestamps.
+ */
+static inline uint64_t
+get_monotonic_time(void)
+{
+	struct timespec timespec;
+
+	clock_gettime(CLOCK_MONOTONIC, &timespec);
+	return timespec.tv_sec * 1000000000ull + timespec.tv_nsec;
+}
+
 extern pixman_box32_t infinite_extents;
 
 static inline bool
@@ -83,6 +97,13 @@ rectangle_contains_point(const struct swc_rectangle *rectangle, int32_t x, int32
 	       && y > rectangle->y && y < rectangle->y + rectangle->height;
 }
 
+static inline bool
+rectangle_contains_rectangle(const struct swc_rectangle *r1, const struct swc_rectangle *r2)
+{
+	return r2->x >= r1->x && r2->x + r2->width <= r1->x + r1->width
+	       && r2->y >= r1->y && r2->y + r2->height <= r1->y + r1->height;
+}
+
 static inline bool
 rectangle_overlap(const struct swc_rectangle *r1, const struct swc_rectangle *r2)
 {
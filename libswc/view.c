@@ -46,7 +46,7 @@ view_initialize(struct view *view, const struct view_impl *impl)
 	view->geometry.width = 0;
 	view->geometry.height = 0;
 	view->buffer = NULL;
-	view->screens = 0;
+	screen_set_initialize(&view->screens);
 	wl_list_init(&view->handlers);
 }
 
@@ -55,6 +55,7 @@ view_finalize(struct view *view)
 {
 	if (view->buffer)
 		wld_buffer_unreference(view->buffer);
+	screen_set_finalize(&view->screens);
 }
 
 int
@@ -129,30 +130,42 @@ view_set_size_from_buffer(struct view *view, struct wld_buffer *buffer)
 }
 
 void
-view_set_screens(struct view *view, uint32_t screens)
+view_set_screens(struct view *view, const struct screen_set *screens)
 {
-	if (view->screens == screens)
+	struct screen_set entered, left;
+	struct view_handler *handler;
+
+	if (screen_set_equal(&view->screens, screens))
 		return;
 
-	uint32_t entered = screens & ~view->screens, left = view->screens & ~screens;
-	struct view_handler *handler;
+	screen_set_initialize(&entered);
+	screen_set_initialize(&left);
+	screen_set_copy(&entered, screens);
+	screen_set_subtract(&entered, &view->screens);
+	screen_set_copy(&left, &view->screens);
+	screen_set_subtract(&left, screens);
+
+	screen_set_copy(&view->screens, screens);
+	HANDLE(view, handler, screens, &entered, &left);
 
-	view->screens = screens;
-	HANDLE(view, handler, screens, entered, left);
+	screen_set_finalize(&entered);
+	screen_set_finalize(&left);
 }
 
 void
 view_update_screens(struct view *view)
 {
-	uint32_t screens = 0;
+	struct screen_set screens;
 	struct screen *screen;
 
+	screen_set_initialize(&screens);
 	wl_list_for_each (screen, &swc.screens, link) {
 		if (rectangle_overlap(&screen->base.geometry, &view->geometry))
-			screens |= screen_mask(screen);
+			screen_set_add(&screens, screen->id);
 	}
 
-	view_set_screens(view, screens);
+	view_set_screens(view, &screens);
+	screen_set_finalize(&screens);
 }
 
 void
@@ -24,6 +24,7 @@
 #ifndef SWC_VIEW_H
 #define SWC_VIEW_H
 
+#include "screen_set.h"
 #include "swc.h"
 
 /**
@@ -43,7 +44,7 @@ struct view {
 	struct wl_list handlers;
 
 	struct swc_rectangle geometry;
-	uint32_t screens;
+	struct screen_set screens;
 
 	struct wld_buffer *buffer;
 };
@@ -74,7 +75,7 @@ struct view_handler_impl {
 	/* Called after the view's size changes. */
 	void (*resize)(struct view_handler *handler, uint32_t old_width, uint32_t old_height);
 	/* Called when the set of screens the view is visible on changes. */
-	void (*screens)(struct view_handler *handler, uint32_t left, uint32_t entered);
+	void (*screens)(struct view_handler *handler, const struct screen_set *entered, const struct screen_set *left);
 };
 
 /**
@@ -115,7 +116,7 @@ void view_finalize(struct view *view);
 bool view_set_position(struct view *view, int32_t x, int32_t y);
 bool view_set_size(struct view *view, uint32_t width, uint32_t height);
 bool view_set_size_from_buffer(struct view *view, struct wld_buffer *bufer);
-void view_set_screens(struct view *view, uint32_t screens);
+void view_set_screens(struct view *view, const struct screen_set *screens);
 void view_update_screens(struct view *view);
 
 /**
@@ -74,6 +74,7 @@ begin_interaction(struct window_pointer_interaction *interaction, struct button
 
 	interaction->active = true;
 	wl_list_insert(&swc.seat->pointer->handlers, &interaction->handler.link);
+	compositor_view_begin_interaction(interaction->view);
 }
 
 static void
@@ -98,6 +99,7 @@ end_interaction(struct window_pointer_interaction *interaction, struct button *b
 remove:
 	interaction->active = false;
 	wl_list_remove(&interaction->handler.link);
+	compositor_view_end_interaction(interaction->view);
 }
 
 static void
@@ -257,6 +259,12 @@ swc_window_set_border(struct swc_window *window, uint32_t border_color, uint32_t
 	compositor_view_set_border_width(view, border_width);
 }
 
+EXPORT void
+swc_window_set_frame_rate_limit(struct swc_window *window, uint32_t rate)
+{
+	compositor_view_set_frame_rate_limit(INTERNAL(window)->view, rate);
+}
+
 EXPORT void
 swc_window_begin_move(struct swc_window *window)
 {
@@ -379,6 +387,7 @@ window_initialize(struct window *window, const struct window_impl *impl, struct
 	window->mode = WINDOW_MODE_STACKED;
 	window->move.pending = false;
 	window->move.interaction.active = false;
+	window->move.interaction.view = window->view;
 	window->move.interaction.handler = (struct pointer_handler){
 		.motion = move_motion,
 		.button = handle_button,
@@ -387,6 +396,7 @@ window_initialize(struct window *window, const struct window_impl *impl, struct
 	window->configure.width = 0;
 	window->configure.height = 0;
 	window->resize.interaction.active = false;
+	window->resize.interaction.view = window->view;
 	window->resize.interaction.handler = (struct pointer_handler){
 		.motion = resize_motion,
 		.button = handle_button,
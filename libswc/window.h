@@ -34,6 +34,7 @@ struct window_pointer_interaction {
 	bool active;
 	uint32_t serial;
 	struct pointer_handler handler, *original_handler;
+	struct compositor_view *view;
 };
 
 enum window_mode {
@@ -6,7 +6,10 @@ wayland_protocols := $(call pkgconfig,wayland-protocols,variable=pkgdatadir,DATA
 PROTOCOL_EXTENSIONS =           \
     $(dir)/swc.xml              \
     $(dir)/wayland-drm.xml      \
-    $(wayland_protocols)/stable/xdg-shell/xdg-shell.xml
+    $(dir)/wlr-output-power-management-unstable-v1.xml \
+    $(wayland_protocols)/stable/presentation-time/presentation-time.xml \
+    $(wayland_protocols)/stable/xdg-shell/xdg-shell.xml \
+    $(wayland_protocols)/staging/tearing-control/tearing-control-v1.xml
 
 $(dir)_PACKAGES := wayland-server
 